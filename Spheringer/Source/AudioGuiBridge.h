@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    AudioGuiBridge.h
+    Wait-free queues between the audio thread and the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Single-producer, single-consumer queue over a fixed array. Neither side ever
+    blocks or allocates: a push into a full queue is simply dropped, which for
+    meters and keyboard display is better than making the audio thread wait.
+*/
+template <typename Item, int capacity>
+class SpscFifo
+{
+public:
+    bool push (const Item& item) noexcept
+    {
+        const auto scope = fifo.write (1);
+
+        if (scope.blockSize1 == 0)
+            return false;
+
+        items[(size_t) scope.startIndex1] = item;
+        return true;
+    }
+
+    bool pop (Item& item) noexcept
+    {
+        const auto scope = fifo.read (1);
+
+        if (scope.blockSize1 == 0)
+            return false;
+
+        item = items[(size_t) scope.startIndex1];
+        return true;
+    }
+
+    // Consumer side only
+    bool isEmpty() const noexcept
+    {
+        return fifo.getNumReady() == 0;
+    }
+
+    void clear() noexcept
+    {
+        Item discarded;
+
+        while (pop (discarded)) {}
+    }
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<Item, (size_t) capacity> items {};
+};
+
+//==============================================================================
+struct NoteEvent
+{
+    int midiChannel = 1;
+    int noteNumber = 0;
+    float velocity = 0.0f;
+    bool isNoteOn = false;
+};
+
+static constexpr int numMeterChannels = 4; // quad: L, R, Ls, Rs
+
+struct MeterFrame
+{
+    std::array<float, numMeterChannels> peak {}, rms {};
+};
+
+/** What the audio thread tells the editor. */
+struct GuiEvent
+{
+    enum class Type { note, meter };
+
+    Type type = Type::note;
+    NoteEvent note;
+    int layer = -1; // the dynamic layer a note-on plays, for the waveform view
+    MeterFrame meter;
+};
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    CpuBudget.cpp
+
+  ==============================================================================
+*/
+
+#include "CpuBudget.h"
+
+namespace
+{
+    // Smoothing for the cost estimates: quick to react to spikes, slow to trust a quiet spell
+    constexpr double riseCoefficient = 0.5;
+    constexpr double fallCoefficient = 0.02;
+
+    void smooth (double& estimate, double measured) noexcept
+    {
+        estimate += (measured - estimate) * (measured > estimate ? riseCoefficient : fallCoefficient);
+    }
+}
+
+//==============================================================================
+void CpuBudget::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    overheadCost = voiceCost = 0.0;
+    load = 0.0f;
+}
+
+void CpuBudget::setBudget (float fractionOfBufferPeriod) noexcept
+{
+    budget.store (juce::jlimit (0.05f, 1.0f, fractionOfBufferPeriod), std::memory_order_relaxed);
+}
+
+void CpuBudget::startBlock() noexcept
+{
+    blockStartTicks = juce::Time::getHighResolutionTicks();
+}
+
+void CpuBudget::endBlock (int numSamples, int numVoicesRendered) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    const double elapsed = (double) (juce::Time::getHighResolutionTicks() - blockStartTicks) * secondsPerTick;
+    const double costPerSample = elapsed / numSamples;
+
+    load = (float) (costPerSample * sampleRate);
+
+    if (numVoicesRendered == 0)
+        smooth (overheadCost, costPerSample);
+    else
+        smooth (voiceCost, juce::jmax (0.0, costPerSample - overheadCost) / numVoicesRendered);
+}
+
+int CpuBudget::getAffordableVoices() const noexcept
+{
+    if (voiceCost <= 0.0)
+        return std::numeric_limits<int>::max(); // nothing measured yet
+
+    const double available = getBudget() / sampleRate - overheadCost;
+    return juce::jmax (0, (int) (available / voiceCost));
+}
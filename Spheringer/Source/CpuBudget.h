@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    CpuBudget.h
+    Measures how long the render path takes and works out how many voices
+    still fit inside a fraction of the buffer period.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Block cost is modelled as a fixed overhead plus a cost per voice, both per
+    sample and both learnt from measurements: blocks without voices update the
+    overhead, blocks with voices update the per-voice cost. Estimates rise fast
+    and decay slowly, so one lucky block doesn't bring all the voices back.
+*/
+class CpuBudget
+{
+public:
+    //==============================================================================
+    void prepare (double sampleRate);
+
+    // Fraction of the buffer period the render path may use, e.g. 0.7
+    void setBudget (float fractionOfBufferPeriod) noexcept;
+    float getBudget() const noexcept { return budget.load (std::memory_order_relaxed); }
+
+    // Call around the part of processBlock that is being budgeted
+    void startBlock() noexcept;
+    void endBlock (int numSamples, int numVoicesRendered) noexcept;
+
+    // Last measured block, as a fraction of its buffer period
+    float getLoad() const noexcept { return load; }
+
+    // How many voices can be rendered next block without going over the budget
+    int getAffordableVoices() const noexcept;
+
+private:
+    //==============================================================================
+    std::atomic<float> budget {0.7f};
+
+    double sampleRate = 44100.0;
+    double secondsPerTick = 1.0 / (double) juce::Time::getHighResolutionTicksPerSecond();
+    juce::int64 blockStartTicks = 0;
+
+    // Seconds per output sample
+    double overheadCost = 0.0;
+    double voiceCost = 0.0;
+
+    float load = 0.0f;
+};
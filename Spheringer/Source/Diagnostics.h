@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    Diagnostics.h
+    Counters written by the audio thread and polled by the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** Everything in here is a relaxed atomic: the audio or loader thread only ever
+    stores or increments, and the editor only reads, so nobody waits on anybody.
+*/
+struct Diagnostics
+{
+    // Render time of the last block as a fraction of its buffer period
+    std::atomic<float> cpuLoad {0.0f};
+
+    std::atomic<int> activeVoices {0};
+    std::atomic<int> polyphonyLimit {0};
+
+    // Voices faded out early, either to make room for a new note or to stay inside the CPU budget
+    std::atomic<juce::uint32> voicesStolen {0};
+    std::atomic<juce::uint32> voicesStolenForCpu {0};
+
+    // Sample cache: note-ons that found their zone in memory, and those that had to wait for it
+    std::atomic<juce::uint32> cacheHits {0};
+    std::atomic<juce::uint32> cacheMisses {0};
+
+    // Decoded sample data currently in memory for this instance's libraries, written by the loader thread.
+    // Zones shared with other instances count in each of them, but are only held once.
+    std::atomic<juce::int64> residentSampleBytes {0};
+
+    // Sample data locked in RAM by all instances, and whether the lock limit stopped any more being locked
+    std::atomic<juce::int64> lockedSampleBytes {0};
+    std::atomic<bool> sampleLockLimitReached {false};
+
+    // Sample data not kept because it was silence before the onset or after the decay
+    std::atomic<juce::int64> preprocessingBytesSaved {0};
+
+    // Deepest output limiter gain reduction during the last block, as a positive number
+    std::atomic<float> limiterGainReductionDb {0.0f};
+};
@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    FileHash.cpp
+
+  ==============================================================================
+*/
+
+#include "FileHash.h"
+#include "RealtimeGuard.h"
+
+juce::String FileHash::ofContent (const juce::File& file)
+{
+    RealtimeGuard::check ("FileHash::ofContent");
+
+    juce::FileInputStream stream (file);
+
+    if (stream.failedToOpen())
+        return {};
+
+    constexpr juce::uint64 offsetBasis = 14695981039346656037ull;
+    constexpr juce::uint64 prime = 1099511628211ull;
+
+    juce::uint64 hash = offsetBasis;
+    std::vector<juce::uint8> chunk (1 << 16);
+
+    for (;;)
+    {
+        const int numRead = stream.read (chunk.data(), (int) chunk.size());
+
+        if (numRead <= 0)
+            break;
+
+        for (int i = 0; i < numRead; ++i)
+            hash = (hash ^ chunk[(size_t) i]) * prime;
+    }
+
+    return juce::String::toHexString ((juce::int64) hash).paddedLeft ('0', 16);
+}
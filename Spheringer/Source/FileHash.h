@@ -0,0 +1,20 @@
+/*
+  ==============================================================================
+
+    FileHash.h
+    Content hash used to recognise sample files across sessions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace FileHash
+{
+    /** 64-bit FNV-1a over the file's bytes, as 16 hex digits.
+        Returns an empty string if the file can't be read.
+    */
+    juce::String ofContent (const juce::File& file);
+}
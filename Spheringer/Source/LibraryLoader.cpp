@@ -0,0 +1,790 @@
+/*
+  ==============================================================================
+
+    LibraryLoader.cpp
+
+  ==============================================================================
+*/
+
+#include "LibraryLoader.h"
+#include "FileHash.h"
+#include "QuadUpmix.h"
+#include "PitchDetector.h"
+#include "RealtimeGuard.h"
+#include "Trace.h"
+
+//==============================================================================
+LibraryLoader::LibraryLoader (ThumbnailCache& thumbnailsToFill, Diagnostics& diagnosticsToUpdate, PublishCallback publishLibrary)
+    : juce::Thread ("Spheringer library loader"),
+      thumbnails (thumbnailsToFill),
+      diagnostics (diagnosticsToUpdate),
+      publishCallback (std::move (publishLibrary))
+{
+    // allows plugin to use basic audio formats, e.g. .mp3, .wav, ...
+    formatManager.registerBasicFormats();
+    startThread();
+}
+
+LibraryLoader::~LibraryLoader()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (5000);
+
+    // The zones go once the other instances, and any voices of ours that are still ringing, are done with them
+    sharedZones->releaseAll (this);
+    sharedZones->releaseUnused();
+}
+
+void LibraryLoader::loadFolder (int bank, const juce::File& folder)
+{
+    RealtimeGuard::check ("LibraryLoader::loadFolder");
+    jassert (juce::isPositiveAndBelow (bank, maxBanks));
+
+    {
+        const juce::ScopedLock sl (pendingLock);
+        pendingFolders[bank] = folder;
+    }
+
+    notify();
+}
+
+//==============================================================================
+void LibraryLoader::run()
+{
+    SPHERINGER_TRACE_THREAD ("Library loader");
+
+    while (! threadShouldExit())
+    {
+        std::map<int, juce::File> requestedFolders;
+
+        {
+            const juce::ScopedLock sl (pendingLock);
+            std::swap (requestedFolders, pendingFolders);
+        }
+
+        // A new folder starts from an empty library, so everything in it counts as added
+        for (const auto& requested : requestedFolders)
+        {
+            if (! juce::isPositiveAndBelow (requested.first, maxBanks) || ! requested.second.isDirectory())
+                continue;
+
+            DBG ("Bank " << requested.first << ": " << requested.second.getFullPathName());
+
+            auto& bank = banks[(size_t) requested.first];
+            bank.folder = requested.second;
+            bank.index.clear();
+            bank.library = new SampleLibrary();
+            bank.scanNow = true;
+
+            if (requested.first == thumbnailBank)
+                thumbnails.clear();
+
+            publish (requested.first, bank.library);
+        }
+
+        // Another program was selected
+        const int bankToShow = juce::jlimit (0, maxBanks - 1, shownBank.load());
+
+        if (bankToShow != thumbnailBank)
+            showThumbnails (bankToShow);
+
+        // Notes waiting for their samples come first, the folders can wait
+        serviceRequests();
+
+        const bool scanRequested = std::any_of (banks.begin(), banks.end(), [] (const Bank& bank) { return bank.scanNow; });
+
+        if (scanRequested || juce::Time::getMillisecondCounter() - lastScanTime >= (juce::uint32) pollIntervalMs)
+        {
+            for (int i = 0; i < maxBanks && ! threadShouldExit(); ++i)
+            {
+                if (banks[(size_t) i].folder.isDirectory())
+                    scanFolder (i);
+
+                banks[(size_t) i].scanNow = false;
+            }
+
+            releaseUnusedObjects();
+            enforceMemoryBudget();
+
+            lastScanTime = juce::Time::getMillisecondCounter();
+            preloadPending = true;
+        }
+
+        preloadBanks();
+
+        wait (requestPollMs);
+    }
+}
+
+void LibraryLoader::scanFolder (int bankIndex)
+{
+    SPHERINGER_TRACE_SCOPE ("scanFolder");
+
+    auto& bank = banks[(size_t) bankIndex];
+    auto& index = bank.index;
+    const bool isShown = bankIndex == thumbnailBank;
+
+    juce::Array<juce::File> audioFiles; // pre-load files allocate to this array
+    bank.folder.findChildFiles (audioFiles, juce::File::TypesOfFileToFind::findFiles, true, "*.wav"); // search for .wav files
+
+    const auto settledBefore = juce::Time::getCurrentTime() - juce::RelativeTime::milliseconds (settleTimeMs);
+
+    struct Change
+    {
+        juce::File file;
+        IndexEntry entry;
+        std::shared_ptr<const WaveformSummary> cachedThumbnail;
+        int previousNote = -1, previousLayer = -1; // where the file was mapped before it changed, if it was
+    };
+
+    std::vector<Change> changes;
+    std::set<juce::String> stillThere;
+
+    for (const auto& file : audioFiles)
+    {
+        if (threadShouldExit())
+            return;
+
+        const auto path = file.getFullPathName();
+        stillThere.insert (path);
+
+        IndexEntry entry;
+        entry.size = file.getSize();
+        entry.modified = file.getLastModificationTime();
+
+        if (entry.modified > settledBefore)
+            continue;
+
+        const auto known = index.find (path);
+
+        if (known != index.end() && known->second.size == entry.size && known->second.modified == entry.modified)
+            continue;
+
+        // if files are named like ****_C4_60.wav that would be very helpful!!
+        // Dynamic layers are named too, e.g. ****_forte_C4_60.wav
+        // Without a number the note comes from pitch detection, and isn't known until the file is decoded.
+        entry.noteNumber = getNoteNumberFromFileName (file);
+        entry.layer = DynamicLayer::fromFileName (file.getFileNameWithoutExtension());
+
+        // Saved again without changing anything, e.g. an export that was re-run
+        entry.contentHash = FileHash::ofContent (file);
+
+        if (known != index.end() && known->second.contentHash == entry.contentHash)
+        {
+            entry.noteNumber = known->second.noteNumber;
+            entry.bytesSaved = known->second.bytesSaved;
+            known->second = entry;
+            continue;
+        }
+
+        // Show whatever we summarised last time straight away, decoding the samples takes much longer.
+        // The summary also remembers the detected pitch.
+        auto cached = thumbnails.loadFromDisk (entry.contentHash);
+
+        if (cached != nullptr && entry.noteNumber < 0)
+            entry.noteNumber = cached->rootNote;
+
+        if (cached != nullptr && isShown && ! isHeldByAnotherFile (*bank.library, entry.noteNumber, entry.layer, path))
+            thumbnails.setThumbnail (entry.noteNumber, entry.layer, { file.getFileName(), cached });
+
+        Change change { file, entry, std::move (cached) };
+
+        if (known != index.end())
+        {
+            change.previousNote = known->second.noteNumber;
+            change.previousLayer = known->second.layer;
+        }
+
+        changes.push_back (std::move (change));
+    }
+
+    std::vector<std::pair<juce::String, IndexEntry>> removedFiles;
+
+    for (auto entry = index.begin(); entry != index.end();)
+    {
+        if (stillThere.count (entry->first) != 0)
+        {
+            ++entry;
+            continue;
+        }
+
+        removedFiles.emplace_back (*entry);
+        entry = index.erase (entry);
+    }
+
+    if (changes.empty() && removedFiles.empty())
+        return;
+
+    // Shares every zone that didn't change with the library the audio thread is playing from
+    SampleLibrary::Ptr newLibrary (new SampleLibrary (*bank.library));
+
+    for (const auto& removed : removedFiles)
+        unmapFile (bank, *newLibrary, removed.first, removed.second.noteNumber, removed.second.layer, isShown);
+
+    // Decode and preprocess in parallel, every job only fills its own slot
+    std::vector<SampleZone::Ptr> zones (changes.size());
+
+    // Decoded zones only stay in memory while they fit, so a first load of a library bigger than the budget
+    // never holds more than the budget plus the zones being decoded right now
+    const auto budget = memoryBudget.load();
+    std::atomic<juce::int64> residentBytes { getResidentBytes() };
+
+    for (size_t i = 0; i < changes.size(); ++i)
+    {
+        decodePool.addJob ([this, isShown, budget, &residentBytes, &change = changes[i], &zone = zones[i]]
+        {
+            SPHERINGER_TRACE_THREAD ("Library decoder");
+            SPHERINGER_TRACE_SCOPE ("decodeJob");
+
+            if (threadShouldExit())
+                return;
+
+            // Another instance may have loaded this very file already
+            const auto key = SharedZoneCache::makeKey (change.file, change.entry.contentHash);
+            const auto& cached = change.cachedThumbnail;
+            zone = sharedZones->acquire (key, this);
+
+            // With a thumbnail we already know the loop and the trim, so the samples can wait until a note needs them
+            bool decodedHere = false;
+
+            if (zone == nullptr)
+            {
+                auto made = cached != nullptr ? createUnloadedZone (change.file, *cached) : decodeZone (change.file);
+
+                if (made != nullptr)
+                {
+                    zone = sharedZones->add (key, made, this);
+                    decodedHere = cached == nullptr && zone == made;
+                }
+            }
+
+            // Pinned, so no other instance evicts the samples while they are summarised
+            if (zone != nullptr && cached == nullptr)
+            {
+                if (zone->pin())
+                {
+                    auto summary = WaveformSummary::create (*zone);
+                    thumbnails.saveToDisk (change.entry.contentHash, *summary);
+
+                    if (isShown)
+                        thumbnails.setThumbnail (zone->rootNote, zone->layer, { change.file.getFileName(), std::move (summary) });
+                }
+
+                zone->unpin();
+            }
+
+            // Over budget: published unloaded, the same as a zone made from its thumbnail, and loaded when played
+            if (decodedHere)
+            {
+                const auto size = zone->getSizeInBytes();
+
+                if (residentBytes.fetch_add (size) + size > budget && tryEvict (*zone))
+                    residentBytes -= size;
+            }
+        });
+    }
+
+    while (decodePool.getNumJobs() > 0)
+        wait (1);
+
+    if (threadShouldExit())
+        return;
+
+    // A file whose detected pitch changed leaves its old note first, so the old note doesn't keep playing the old samples
+    for (size_t i = 0; i < changes.size(); ++i)
+    {
+        const auto& change = changes[i];
+
+        if (zones[i] != nullptr && change.previousNote >= 0
+             && (change.previousNote != zones[i]->rootNote || change.previousLayer != zones[i]->layer))
+            unmapFile (bank, *newLibrary, change.file.getFullPathName(), change.previousNote, change.previousLayer, isShown);
+    }
+
+    for (size_t i = 0; i < changes.size(); ++i)
+    {
+        auto& zone = zones[i];
+
+        // Not readable (yet), so leave it out of the index and try again on the next poll
+        if (zone == nullptr)
+            continue;
+
+        // The zone knows the note, also when it had to be detected
+        const auto path = changes[i].file.getFullPathName();
+        auto& entry = changes[i].entry;
+        entry.noteNumber = zone->rootNote;
+        entry.bytesSaved = (juce::int64) (zone->trim.sourceLength - zone->trim.length) * QuadFrameBuffer::numChannels * (juce::int64) sizeof (float);
+
+        // Indexed either way, so it isn't decoded again on every poll
+        index[path] = entry;
+
+        // Two files for the same note and layer: the one that got there first keeps it. The other
+        // one is mapped once that file goes away or moves to another note.
+        if (isHeldByAnotherFile (*newLibrary, entry.noteNumber, entry.layer, path))
+        {
+            const auto& holder = newLibrary->zones[entry.noteNumber][(size_t) entry.layer]->sourceFile;
+
+            DBG ("Not mapping " << changes[i].file.getFileName() << ": note " << entry.noteNumber
+                   << ", layer " << entry.layer << " is already played from " << holder.getFileName());
+
+            sharedZones->release (*zone, this);
+
+            // The decode job showed the thumbnail of the file that lost, put the holder's back
+            const auto holderEntry = index.find (holder.getFullPathName());
+
+            if (isShown && holderEntry != index.end())
+                if (auto summary = thumbnails.loadFromDisk (holderEntry->second.contentHash))
+                    thumbnails.setThumbnail (entry.noteNumber, entry.layer, { holder.getFileName(), std::move (summary) });
+
+            continue;
+        }
+
+        newLibrary->zones[entry.noteNumber][(size_t) entry.layer] = zone;
+    }
+
+    juce::int64 bytesSaved = 0;
+
+    for (const auto& other : banks)
+        for (const auto& entry : other.index)
+            bytesSaved += entry.second.bytesSaved;
+
+    diagnostics.preprocessingBytesSaved.store (bytesSaved, std::memory_order_relaxed);
+
+    bank.library = newLibrary;
+    publish (bankIndex, newLibrary);
+}
+
+void LibraryLoader::showThumbnails (int bankIndex)
+{
+    thumbnailBank = bankIndex;
+    thumbnails.clear();
+
+    const auto& bank = banks[(size_t) bankIndex];
+
+    // Every indexed file was summarised when it was decoded, so the summaries are all on disk.
+    // Files that lost their note and layer to another file aren't played, so they aren't shown either.
+    for (const auto& entry : bank.index)
+    {
+        if (bank.library != nullptr && isHeldByAnotherFile (*bank.library, entry.second.noteNumber, entry.second.layer, entry.first))
+            continue;
+
+        if (auto summary = thumbnails.loadFromDisk (entry.second.contentHash))
+            thumbnails.setThumbnail (entry.second.noteNumber, entry.second.layer, { juce::File (entry.first).getFileName(), std::move (summary) });
+    }
+
+    // Its zones are the likeliest to be played next
+    preloadPending = true;
+}
+
+bool LibraryLoader::isHeldByAnotherFile (const SampleLibrary& library, int noteNumber, int layer, const juce::String& path)
+{
+    const auto zone = library.getZone (noteNumber, layer);
+    return zone != nullptr && zone->sourceFile.getFullPathName() != path;
+}
+
+void LibraryLoader::unmapFile (Bank& bank, SampleLibrary& library, const juce::String& path, int noteNumber, int layer, bool isShown)
+{
+    const auto layers = library.zones.find (noteNumber);
+
+    // Only if the slot plays this file: it may have lost the slot to another one
+    if (layers == library.zones.end() || layers->second[(size_t) layer] == nullptr
+         || layers->second[(size_t) layer]->sourceFile.getFullPathName() != path)
+        return;
+
+    layers->second[(size_t) layer] = nullptr;
+
+    if (isShown)
+        thumbnails.removeThumbnail (noteNumber, layer);
+
+    if (std::all_of (layers->second.begin(), layers->second.end(), [] (const SampleZone::Ptr& zone) { return zone == nullptr; }))
+        library.zones.erase (layers);
+
+    // Files that lost this slot to it are forgotten, so the next scan maps one of them instead
+    for (auto entry = bank.index.begin(); entry != bank.index.end();)
+    {
+        if (entry->first != path && entry->second.noteNumber == noteNumber && entry->second.layer == layer)
+            entry = bank.index.erase (entry);
+        else
+            ++entry;
+    }
+}
+
+void LibraryLoader::preloadBanks()
+{
+    if (! preloadPending)
+        return;
+
+    const auto budget = memoryBudget.load();
+    const auto residentBytes = getResidentBytes();
+
+    // The shown bank first, then the rest in program order
+    for (int i = 0; i < maxBanks; ++i)
+    {
+        const int bankIndex = i == 0 ? thumbnailBank : (i - 1 < thumbnailBank ? i - 1 : i);
+        const auto& library = banks[(size_t) bankIndex].library;
+
+        if (library == nullptr)
+            continue;
+
+        for (const auto& note : library->zones)
+        {
+            for (const auto& zone : note.second)
+            {
+                if (zone == nullptr || zone->isResident())
+                    continue;
+
+                // One zone per round, so notes waiting for their samples never wait for a whole bank.
+                // Stops short of the budget: preloading never evicts anything.
+                if (residentBytes + zone->getSizeInBytes() > budget || ! makeResident (*zone))
+                    preloadPending = false;
+
+                return;
+            }
+        }
+    }
+
+    preloadPending = false;
+}
+
+int LibraryLoader::getNoteNumberFromFileName (const juce::File& file)
+{
+    const auto name = file.getFileNameWithoutExtension();
+
+    if (name.isEmpty() || ! juce::CharacterFunctions::isDigit (name.getLastCharacter()))
+        return -1;
+
+    return juce::jlimit (0, 127, name.getTrailingIntValue());
+}
+
+SampleZone::Ptr LibraryLoader::decodeZone (const juce::File& file)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+    if (reader == nullptr)
+        return nullptr;
+
+    const int numChannels = (int) reader->numChannels;
+    const int numSamples = static_cast<int> (reader->lengthInSamples); //int64 to int32
+    DBG ("File loaded! Filename: " << file.getFileName() << ", Number of channels: " << numChannels);
+
+    juce::AudioSampleBuffer source (numChannels, numSamples);
+
+    // set the `useReaderLeftChannel` and `useReaderRightChannel` to false!!!!
+    reader->read (&source, 0, numSamples, 0, false, false);
+
+    // A loop stored in the WAV smpl chunk has to survive the trim
+    auto loop = LoopFinder::fromMetadata (reader->metadataValues, numSamples);
+    const auto trim = SamplePreprocessor::analyse (source, reader->sampleRate, loop.isValid() ? loop.end : 0);
+
+    SampleZone::Ptr zone (new SampleZone());
+    zone->rootNote = getNoteNumberFromFileName (file);
+    zone->layer = DynamicLayer::fromFileName (file.getFileNameWithoutExtension());
+    zone->sampleRate = reader->sampleRate;
+    zone->sourceFile = file;
+    zone->trim = trim;
+    auto samples = SamplePreprocessor::apply (source, trim);
+
+    // No note number in the name: listen for it once the attack is over. Unpitched sounds end up on note 0, as they always have.
+    if (zone->rootNote < 0)
+    {
+        const auto pitch = PitchDetector::detect (samples, zone->sampleRate, trim.fadeInLength + juce::roundToInt (pitchAnalysisDelaySeconds * zone->sampleRate));
+        zone->rootNote = pitch.isPitched ? pitch.noteNumber : 0;
+        zone->tuningCents = pitch.isPitched ? pitch.centsOffset : 0.0f;
+
+        DBG ("Detected pitch: " << pitch.frequency << " Hz, note " << zone->rootNote << " " << zone->tuningCents << " cents");
+    }
+
+    if (loop.isValid())
+    {
+        loop.start -= trim.start;
+        loop.end -= trim.start;
+
+        // Starting inside the silence or the fade-in before the onset: not a sustain loop we can use
+        if (loop.start < trim.fadeInLength)
+            loop = {};
+    }
+
+    // Sustain loop: take the one stored in the WAV smpl chunk if there is one, otherwise look for one
+    zone->loop = loop.isValid() ? loop : LoopFinder::findByAutocorrelation (samples, zone->sampleRate);
+
+    // Before the crossfade, so the decorrelated rears loop as cleanly as the fronts
+    QuadUpmix::apply (samples, zone->sampleRate);
+
+    if (zone->loop.isValid())
+    {
+        LoopFinder::bakeCrossfade (samples, zone->loop, juce::roundToInt (loopCrossfadeSeconds * zone->sampleRate));
+        DBG ("Loop found: " << zone->loop.start << " - " << zone->loop.end << " of " << numSamples << " samples");
+    }
+
+    // Resident for now: scanFolder drops the samples again once they're summarised, if they don't fit the budget
+    zone->numChannels = juce::jmin (samples.getNumChannels(), QuadFrameBuffer::numChannels);
+    zone->numSamples = samples.getNumSamples();
+    storeFrames (*zone, samples);
+    zone->resident = true;
+
+    return zone;
+}
+
+SampleZone::Ptr LibraryLoader::createUnloadedZone (const juce::File& file, const WaveformSummary& summary)
+{
+    // A number in the name still wins over a pitch detected before the file was renamed
+    const int namedNote = getNoteNumberFromFileName (file);
+
+    SampleZone::Ptr zone (new SampleZone());
+    zone->rootNote = namedNote >= 0 ? namedNote : summary.rootNote;
+    zone->tuningCents = namedNote >= 0 ? 0.0f : summary.tuningCents;
+    zone->layer = DynamicLayer::fromFileName (file.getFileNameWithoutExtension());
+    zone->sampleRate = summary.sampleRate;
+    zone->sourceFile = file;
+    zone->numChannels = summary.numChannels;
+    zone->numSamples = summary.numSamples;
+    zone->loop = summary.loop;
+    zone->trim = summary.trim;
+
+    return zone;
+}
+
+//==============================================================================
+void LibraryLoader::publish (int bankIndex, SampleLibrary::Ptr newLibrary)
+{
+    publishedLibraries.add (newLibrary);
+
+    for (const auto& note : newLibrary->zones)
+        for (const auto& zone : note.second)
+            if (zone != nullptr)
+                publishedZones.addIfNotAlreadyThere (zone.get());
+
+    publishCallback (bankIndex, std::move (newLibrary));
+}
+
+void LibraryLoader::releaseUnusedObjects()
+{
+    // A count of one means only this array still holds it: no library, voice or pending hand-over does
+    for (int i = publishedLibraries.size(); --i >= 0;)
+        if (publishedLibraries.getObjectPointerUnchecked (i)->getReferenceCount() == 1)
+            publishedLibraries.remove (i);
+
+    // Other instances hold shared zones too, so their reference count says nothing about us. Once none of
+    // our libraries has one, our claim goes back to the cache, whose reference outlives any voice still playing it.
+    std::set<const SampleZone*> inOurLibraries;
+
+    for (const auto* library : publishedLibraries)
+        for (const auto& note : library->zones)
+            for (const auto& zone : note.second)
+                if (zone != nullptr && zone->isShared)
+                    inOurLibraries.insert (zone.get());
+
+    for (int i = publishedZones.size(); --i >= 0;)
+    {
+        const auto* zone = publishedZones.getObjectPointerUnchecked (i);
+
+        if (zone->isShared ? inOurLibraries.count (zone) == 0 : zone->getReferenceCount() == 1)
+        {
+            if (zone->isShared)
+                sharedZones->release (*zone, this);
+
+            publishedZones.remove (i);
+        }
+    }
+
+    sharedZones->releaseUnused();
+}
+
+//==============================================================================
+void LibraryLoader::serviceRequests()
+{
+    SPHERINGER_TRACE_SCOPE ("serviceRequests");
+
+    std::vector<ZoneRequest> requested;
+
+    for (ZoneRequest request; requests.pop (request);)
+        if (juce::isPositiveAndBelow (request.bank, maxBanks))
+            requested.push_back (request);
+
+    if (requested.empty())
+        return;
+
+    // Everything touched in this round counts as used now, so none of it is evicted to make room for the rest.
+    // The clock is shared with the other instances, so a zone they play counts as used here too.
+    useClock = sharedZones->advanceUseClock();
+
+    // Every layer: the controller can bring any of them in while the note is held
+    const auto touch = [this] (int bank, int note)
+    {
+        const auto& library = banks[(size_t) bank].library;
+
+        if (const auto* layers = library != nullptr ? library->getLayers (note) : nullptr)
+        {
+            for (const auto& zone : *layers)
+            {
+                if (zone != nullptr)
+                {
+                    zone->lastUsed = useClock;
+                    makeResident (*zone);
+                }
+            }
+        }
+    };
+
+    // The notes that were played, before any of their neighbours
+    for (const auto& request : requested)
+        touch (request.bank, request.noteNumber);
+
+    for (int distance = 1; distance <= prefetchRadius; ++distance)
+    {
+        for (const auto& request : requested)
+        {
+            touch (request.bank, request.noteNumber - distance);
+            touch (request.bank, request.noteNumber + distance);
+        }
+    }
+
+    enforceMemoryBudget();
+}
+
+bool LibraryLoader::makeResident (SampleZone& zone)
+{
+    if (zone.isResident())
+        return true;
+
+    // Another instance may be loading or evicting the same zone
+    const juce::ScopedLock sl (zone.residencyLock);
+
+    if (zone.isResident())
+        return true;
+
+    SPHERINGER_TRACE_SCOPE ("makeResident");
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (zone.sourceFile));
+
+    // Changed on disk since we indexed it: the next scan will publish a new zone for it
+    const int numSourceChannels = (int) zone.trim.dcOffsets.size();
+
+    if (reader == nullptr || (int) reader->numChannels != numSourceChannels || reader->lengthInSamples != zone.trim.sourceLength)
+        return false;
+
+    // Same processing as decodeZone, minus the analysis: only the part we kept is read back
+    juce::AudioSampleBuffer samples (numSourceChannels, zone.trim.length);
+    reader->read (&samples, 0, zone.trim.length, zone.trim.start, false, false);
+    SamplePreprocessor::applyInPlace (samples, zone.trim);
+    QuadUpmix::apply (samples, zone.sampleRate);
+
+    if (zone.loop.isValid())
+        LoopFinder::bakeCrossfade (samples, zone.loop, juce::roundToInt (loopCrossfadeSeconds * zone.sampleRate));
+
+    jassert (samples.getNumSamples() == zone.numSamples);
+
+    // Nobody reads the frames until resident is set, even if voices are already waiting for them
+    storeFrames (zone, samples);
+    zone.resident = true;
+    return true;
+}
+
+void LibraryLoader::storeFrames (SampleZone& zone, const juce::AudioSampleBuffer& samples)
+{
+    // Interleaved, so a voice reads a whole quad frame with one load. Channels past the fourth aren't played.
+    zone.frames.setSize (samples.getNumSamples());
+    zone.frames.copyFrom (samples, 0, 0, samples.getNumSamples());
+
+    // Locked and faulted in, so the first note doesn't take page faults on the audio thread
+    zone.storage = arena->moveIntoArena (zone.frames);
+}
+
+void LibraryLoader::makeResidentNow (const SampleLibrary::Layers& layers)
+{
+    SPHERINGER_TRACE_SCOPE ("makeResidentNow");
+
+    // The voice has pinned them already, so they stay until it's done. The loader thread counts them against the budget.
+    for (const auto& zone : layers)
+        if (zone != nullptr)
+            makeResident (*zone);
+}
+
+bool LibraryLoader::tryEvict (SampleZone& zone)
+{
+    const juce::ScopedLock sl (zone.residencyLock);
+
+    if (! zone.isResident())
+        return false;
+
+    zone.resident = false;
+
+    // A voice pinned it before it could see the store above, so it may be reading the samples right now
+    if (zone.pins.load() != 0)
+    {
+        zone.resident = true;
+        return false;
+    }
+
+    zone.frames.setSize (0);
+    zone.storage = {};
+    return true;
+}
+
+void LibraryLoader::enforceMemoryBudget()
+{
+    SPHERINGER_TRACE_SCOPE ("enforceMemoryBudget");
+
+    // Every zone still alive is in publishedZones, including old versions that voices are finishing
+    std::vector<SampleZone*> residentZones;
+    juce::int64 residentBytes = 0;
+
+    for (auto* zone : publishedZones)
+    {
+        if (zone->isResident())
+        {
+            residentZones.push_back (zone);
+            residentBytes += zone->getSizeInBytes();
+        }
+    }
+
+    const auto budget = memoryBudget.load();
+
+    if (residentBytes > budget)
+    {
+        // Zones that are no longer in any bank go first, then the least recently played
+        const auto isCurrent = [this] (const SampleZone* zone) { return isInAnyBank (*zone); };
+
+        std::sort (residentZones.begin(), residentZones.end(), [&] (const SampleZone* a, const SampleZone* b)
+        {
+            if (isCurrent (a) != isCurrent (b))
+                return ! isCurrent (a);
+
+            return a->lastUsed.load() < b->lastUsed.load();
+        });
+
+        for (auto* zone : residentZones)
+        {
+            if (residentBytes <= budget)
+                break;
+
+            if (zone->lastUsed == useClock && useClock != 0)
+                continue;
+
+            if (tryEvict (*zone))
+                residentBytes -= zone->getSizeInBytes();
+        }
+    }
+
+    diagnostics.residentSampleBytes.store (residentBytes, std::memory_order_relaxed);
+    diagnostics.lockedSampleBytes.store (arena->getLockedBytes(), std::memory_order_relaxed);
+    diagnostics.sampleLockLimitReached.store (arena->isLockLimitReached(), std::memory_order_relaxed);
+}
+
+juce::int64 LibraryLoader::getResidentBytes() const
+{
+    juce::int64 residentBytes = 0;
+
+    for (const auto* zone : publishedZones)
+        if (zone->isResident())
+            residentBytes += zone->getSizeInBytes();
+
+    return residentBytes;
+}
+
+bool LibraryLoader::isInAnyBank (const SampleZone& zone) const
+{
+    return std::any_of (banks.begin(), banks.end(), [&zone] (const Bank& bank)
+    {
+        return bank.library != nullptr && bank.library->getZone (zone.rootNote, zone.layer).get() == &zone;
+    });
+}
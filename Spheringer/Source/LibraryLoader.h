@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    LibraryLoader.h
+    Decodes and preprocesses sample library folders on background threads,
+    then keeps watching them and re-decodes only the files that change. Also
+    keeps the decoded sample data inside a memory budget.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleZone.h"
+#include "ThumbnailCache.h"
+#include "Diagnostics.h"
+#include "AudioGuiBridge.h"
+#include "SharedZoneCache.h"
+#include "SampleArena.h"
+
+//==============================================================================
+/**
+    Everything slow about loading a library happens here: reading the files,
+    finding loops and summarising the waveforms. The message thread only picks
+    the folder.
+
+    Each folder is a bank, which the processor offers as a program. All banks
+    are indexed and decoded up front, so switching between them is only a
+    pointer swap on the audio thread. The thumbnails show the selected bank.
+
+    Every change to a folder is published as a complete new SampleLibrary that
+    shares the zones which didn't change. The loader keeps a reference to every
+    library and zone it has published until nobody else holds one, so the last
+    reference is never dropped on the audio thread.
+
+    Sample data is loaded when a note asks for it, together with the keys
+    around it, and the least recently played zones are evicted whenever the
+    decoded data goes over the memory budget.
+
+    Zones come from the SharedZoneCache when another instance has already
+    loaded the same file, so all instances playing one library share its
+    sample data.
+*/
+class LibraryLoader  : private juce::Thread
+{
+public:
+    //==============================================================================
+    static constexpr int maxBanks = 32;
+
+    // Called on the loader thread whenever a bank's library changes
+    using PublishCallback = std::function<void (int bank, SampleLibrary::Ptr)>;
+
+    LibraryLoader (ThumbnailCache& thumbnailsToFill, Diagnostics& diagnosticsToUpdate, PublishCallback publishLibrary);
+    ~LibraryLoader() override;
+
+    // Message thread. Replaces the bank's library with the one in this folder and starts watching it.
+    void loadFolder (int bank, const juce::File& folder);
+
+    // Audio thread, on every note-on: loads every layer of the note if needed, prefetches its neighbours and marks them as recently used
+    void requestZone (int bank, int noteNumber) noexcept { requests.push ({ bank, noteNumber }); }
+
+    // Offline audio thread, on a note-on that missed: loads the layers right here, so the bounce doesn't start the note late
+    void makeResidentNow (const SampleLibrary::Layers& layers);
+
+    // Any thread. The bank whose zones go into the ThumbnailCache, and which is preloaded first.
+    void showBank (int bank) noexcept { shownBank = bank; }
+
+    // Any thread. Decoded sample data above this is evicted, least recently played first.
+    void setMemoryBudget (juce::int64 bytes) noexcept { memoryBudget = juce::jmax ((juce::int64) 0, bytes); }
+
+    static constexpr double loopCrossfadeSeconds = 0.1; // baked into each sustain loop
+    static constexpr double pitchAnalysisDelaySeconds = 0.05; // after the onset, to stay clear of the attack
+    static constexpr int pollIntervalMs = 1000;
+    static constexpr int requestPollMs = 5;
+    static constexpr juce::int64 defaultMemoryBudget = (juce::int64) 512 * 1024 * 1024;
+
+    // Keys on either side of a played note that are loaded along with it
+    static constexpr int prefetchRadius = 2;
+
+    // Files modified more recently than this may still be being written, they are picked up on a later poll
+    static constexpr int settleTimeMs = 1000;
+
+private:
+    //==============================================================================
+    // What the folder looked like the last time we decoded it, keyed by full path
+    struct IndexEntry
+    {
+        juce::int64 size = 0;
+        juce::Time modified;
+        juce::String contentHash;
+        int noteNumber = 0;
+        int layer = DynamicLayer::mezzoforte;
+        juce::int64 bytesSaved = 0; // by trimming silence
+    };
+
+    // One folder and what we made of it. Loader thread only.
+    struct Bank
+    {
+        juce::File folder;
+        std::map<juce::String, IndexEntry> index; // keyed by full path
+        SampleLibrary::Ptr library;
+        bool scanNow = false;
+    };
+
+    struct ZoneRequest
+    {
+        int bank = 0, noteNumber = 0;
+    };
+
+    void run() override;
+    void scanFolder (int bankIndex);
+    void showThumbnails (int bankIndex);
+
+    // The keymap: one file per note and layer
+    static bool isHeldByAnotherFile (const SampleLibrary& library, int noteNumber, int layer, const juce::String& path);
+    void unmapFile (Bank& bank, SampleLibrary& library, const juce::String& path, int noteNumber, int layer, bool isShown);
+
+    void preloadBanks();
+    static int getNoteNumberFromFileName (const juce::File& file);
+    SampleZone::Ptr decodeZone (const juce::File& file);
+    SampleZone::Ptr createUnloadedZone (const juce::File& file, const WaveformSummary& summary);
+    void publish (int bankIndex, SampleLibrary::Ptr newLibrary);
+    void releaseUnusedObjects();
+
+    // Sample cache
+    void serviceRequests();
+    bool makeResident (SampleZone& zone);
+    void storeFrames (SampleZone& zone, const juce::AudioSampleBuffer& samples);
+    bool tryEvict (SampleZone& zone);
+    void enforceMemoryBudget();
+    juce::int64 getResidentBytes() const;
+    bool isInAnyBank (const SampleZone& zone) const;
+
+    ThumbnailCache& thumbnails;
+    Diagnostics& diagnostics;
+    PublishCallback publishCallback;
+    juce::AudioFormatManager formatManager;
+    juce::SharedResourcePointer<SharedZoneCache> sharedZones;
+    std::shared_ptr<SampleArena> arena { SampleArena::getShared() };
+
+    // Changed files are decoded and preprocessed side by side
+    juce::ThreadPool decodePool { juce::jmax (1, juce::SystemStats::getNumCpus() - 1) };
+
+    juce::CriticalSection pendingLock;
+    std::map<int, juce::File> pendingFolders; // bank -> folder
+
+    SpscFifo<ZoneRequest, 256> requests;
+    std::atomic<juce::int64> memoryBudget {defaultMemoryBudget};
+    std::atomic<int> shownBank {0};
+
+    // Loader thread only
+    std::array<Bank, maxBanks> banks;
+    int thumbnailBank = 0;
+    bool preloadPending = false;
+    juce::uint32 lastScanTime = 0;
+    juce::uint32 useClock = 0;
+
+    juce::ReferenceCountedArray<SampleLibrary> publishedLibraries;
+    juce::ReferenceCountedArray<SampleZone> publishedZones;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryLoader)
+};
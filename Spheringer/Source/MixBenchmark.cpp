@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    MixBenchmark.cpp
+
+  ==============================================================================
+*/
+
+#include "MixBenchmark.h"
+#include "VoiceSpatialiser.h"
+
+namespace
+{
+    // Every voice moves at every control interval, so the gain ramps are always running.
+    // The bus is cleared at the start of a block, so it still holds the last one afterwards.
+    template <typename Zone, typename Bus, typename ReadBlock, typename FinishBlock>
+    double timeMix (std::vector<VoiceSpatialiser>& spatialisers, const std::vector<Zone>& zones, Zone& scratch,
+                    Bus& bus, int blockSize, int numBlocks, ReadBlock&& readBlock, FinishBlock&& finishBlock)
+    {
+        juce::Random random (1234);
+
+        for (auto& spatialiser : spatialisers)
+            spatialiser.reset ({ random.nextFloat() * juce::MathConstants<float>::twoPi, 0.0f, 1.0f }, MixBenchmark::numChannels);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const int position = (block % MixBenchmark::zoneLengthInBlocks) * blockSize;
+            bus.clear (0, blockSize);
+
+            for (size_t voice = 0; voice < spatialisers.size(); ++voice)
+            {
+                readBlock (zones[voice], position, scratch);
+
+                for (int offset = 0; offset < blockSize; offset += VoiceSpatialiser::controlInterval)
+                {
+                    const int numSamples = juce::jmin (VoiceSpatialiser::controlInterval, blockSize - offset);
+                    const float angle = (float) (block * blockSize + offset) * 1.0e-4f;
+
+                    spatialisers[voice].setTarget ({ angle + (float) voice, 0.1f, 0.8f });
+                    spatialisers[voice].process (scratch, offset, bus, offset, numSamples);
+                }
+            }
+
+            finishBlock();
+        }
+
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) / numBlocks;
+    }
+}
+
+//==============================================================================
+MixBenchmark::Result MixBenchmark::run (int numVoices, int blockSize, int numBlocks)
+{
+    const int zoneLength = blockSize * zoneLengthInBlocks;
+    juce::Random random (42);
+
+    std::vector<juce::AudioSampleBuffer> planarZones;
+    std::vector<QuadFrameBuffer> interleavedZones ((size_t) numVoices);
+
+    for (int voice = 0; voice < numVoices; ++voice)
+    {
+        planarZones.emplace_back (numChannels, zoneLength);
+        auto& zone = planarZones.back();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < zoneLength; ++i)
+                zone.setSample (channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+        interleavedZones[(size_t) voice].setSize (zoneLength);
+        interleavedZones[(size_t) voice].copyFrom (zone, 0, 0, zoneLength);
+    }
+
+    std::vector<VoiceSpatialiser> spatialisers ((size_t) numVoices);
+
+    juce::AudioSampleBuffer planarScratch (numChannels, blockSize);
+    juce::AudioSampleBuffer planar (VoiceSpatialiser::numOutputChannels, blockSize);
+    Result result;
+    result.planarSecondsPerBlock = timeMix (spatialisers, planarZones, planarScratch, planar, blockSize, numBlocks,
+                                            [&] (const juce::AudioSampleBuffer& zone, int position, juce::AudioSampleBuffer& scratch)
+                                            {
+                                                for (int channel = 0; channel < numChannels; ++channel)
+                                                    scratch.copyFrom (channel, 0, zone, channel, position, blockSize);
+                                            },
+                                            [] {});
+
+    QuadFrameBuffer interleavedScratch, interleaved;
+    interleavedScratch.setSize (blockSize);
+    interleaved.setSize (blockSize);
+    juce::AudioSampleBuffer deinterleaved (QuadFrameBuffer::numChannels, blockSize);
+    result.interleavedSecondsPerBlock = timeMix (spatialisers, interleavedZones, interleavedScratch, interleaved, blockSize, numBlocks,
+                                                 [&] (const QuadFrameBuffer& zone, int position, QuadFrameBuffer& scratch)
+                                                 {
+                                                     juce::FloatVectorOperations::copy (scratch.getFrame (0), zone.getFrame (position), blockSize * QuadFrameBuffer::numChannels);
+                                                 },
+                                                 [&] { interleaved.copyTo (deinterleaved, 0, 0, blockSize); });
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int i = 0; i < blockSize; ++i)
+            result.maxDifference = juce::jmax (result.maxDifference, std::abs (planar.getSample (channel, i) - deinterleaved.getSample (channel, i)));
+
+    result.numVoices = numVoices;
+    result.blockSize = blockSize;
+    return result;
+}
+
+juce::String MixBenchmark::Result::toString() const
+{
+    return "Mix benchmark, " + juce::String (numVoices) + " quad voices x " + juce::String (blockSize) + " samples: planar "
+         + juce::String (planarSecondsPerBlock * 1.0e6, 1) + " us/block, interleaved "
+         + juce::String (interleavedSecondsPerBlock * 1.0e6, 1) + " us/block ("
+         + juce::String (planarSecondsPerBlock / juce::jmax (1.0e-12, interleavedSecondsPerBlock), 2) + "x)";
+}
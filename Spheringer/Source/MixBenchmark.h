@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    MixBenchmark.h
+    Times the planar and interleaved voice mix against each other.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Plays numVoices quad zones, all gliding around the listener, the way a
+    voice does: each block is copied out of the zone's storage and mixed into
+    the bus. Once with planar zones into a planar quad buffer, the layout
+    before zones were interleaved, and once with interleaved zones into a
+    QuadFrameBuffer, deinterleaved at the end of every block as processBlock
+    does. Reports the time per block of each.
+
+    Every voice has a zone of its own, several blocks long, so the sample
+    reads aren't all served from one cached block.
+
+    Both runs play the same voices along the same paths, so their last
+    blocks should come out the same; the result says how far apart they are.
+
+    Built in with SPHERINGER_MIX_BENCHMARK, which logs the result when the
+    plugin is created. Allocates, so never call it from the audio thread.
+*/
+struct MixBenchmark
+{
+    struct Result
+    {
+        int numVoices = 0, blockSize = 0;
+        double planarSecondsPerBlock = 0.0, interleavedSecondsPerBlock = 0.0;
+        float maxDifference = 0.0f; // between the two mixes of the last block
+
+        juce::String toString() const;
+    };
+
+    static Result run (int numVoices = 64, int blockSize = 512, int numBlocks = 2000);
+
+    static constexpr int numChannels = 4;      // like every zone once it's upmixed
+    static constexpr int zoneLengthInBlocks = 16;
+};
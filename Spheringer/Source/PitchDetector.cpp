@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    PitchDetector.cpp
+
+  ==============================================================================
+*/
+
+#include "PitchDetector.h"
+#include "SimdFloat4.h"
+
+namespace
+{
+    float dotProduct (const float* a, const float* b, int numSamples) noexcept
+    {
+        auto sum = SimdFloat4::broadcast (0.0f);
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+            sum = sum.multiplyAdd (SimdFloat4::load (a + i), SimdFloat4::load (b + i));
+
+        float result = sum.horizontalSum();
+
+        for (; i < numSamples; ++i)
+            result += a[i] * b[i];
+
+        return result;
+    }
+
+    // Period in samples of the frame starting at `x`, which holds window + maxLag samples; 0 when unvoiced
+    double estimatePeriod (const float* x, const double* energy, int window, int minLag, int maxLag, std::vector<float>& normalised)
+    {
+        const auto energyOf = [energy] (int start, int length) { return energy[start + length] - energy[start]; };
+        const double frameEnergy = energyOf (0, window);
+
+        if (frameEnergy <= 0.0)
+            return 0.0;
+
+        // d'(0) = 1 by definition
+        normalised.assign ((size_t) maxLag + 2, 1.0f);
+        double runningSum = 0.0;
+
+        for (int lag = 1; lag <= maxLag + 1; ++lag)
+        {
+            // Sum over the window of (x[j] - x[j + lag])^2, expanded
+            const double difference = juce::jmax (0.0, frameEnergy + energyOf (lag, window) - 2.0 * dotProduct (x, x + lag, window));
+            runningSum += difference;
+            normalised[(size_t) lag] = runningSum > 0.0 ? (float) (difference * lag / runningSum) : 1.0f;
+        }
+
+        // The first dip under the threshold, followed down to its bottom. That's the fundamental rather than a multiple of it.
+        int best = -1;
+
+        for (int lag = minLag; lag <= maxLag; ++lag)
+        {
+            if (normalised[(size_t) lag] < PitchDetector::threshold)
+            {
+                while (lag + 1 <= maxLag && normalised[(size_t) lag + 1] < normalised[(size_t) lag])
+                    ++lag;
+
+                best = lag;
+                break;
+            }
+        }
+
+        if (best < 0)
+            return 0.0;
+
+        // Between lags: vertex of the parabola through the neighbours
+        const double left = normalised[(size_t) best - 1], centre = normalised[(size_t) best], right = normalised[(size_t) best + 1];
+        const double curvature = left - 2.0 * centre + right;
+
+        return best + (curvature > 0.0 ? 0.5 * (left - right) / curvature : 0.0);
+    }
+}
+
+//==============================================================================
+PitchDetector::Result PitchDetector::detect (const juce::AudioSampleBuffer& buffer, double sampleRate, int analysisStart)
+{
+    const int numChannels = buffer.getNumChannels();
+    const int minLag = juce::jmax (2, (int) (sampleRate / maxFrequency));
+    const int maxLag = (int) std::ceil (sampleRate / minFrequency);
+    const int window = maxLag; // at least one period of the lowest note
+    const int frameLength = window + maxLag + 2;
+
+    // Short samples: start earlier rather than not at all
+    analysisStart = juce::jlimit (0, juce::jmax (0, buffer.getNumSamples() - frameLength), analysisStart);
+    const int available = buffer.getNumSamples() - analysisStart;
+
+    if (numChannels == 0 || available < frameLength)
+        return {};
+
+    // Mono sum of the part we look at
+    std::vector<float> mono ((size_t) available, 0.0f);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::add (mono.data(), buffer.getReadPointer (channel, analysisStart), available);
+
+    std::vector<double> energy ((size_t) available + 1, 0.0);
+
+    for (int i = 0; i < available; ++i)
+        energy[(size_t) i + 1] = energy[(size_t) i] + (double) mono[(size_t) i] * mono[(size_t) i];
+
+    // Frames spread over the first half of what's there, where the note is still strong
+    const int span = juce::jmax (0, juce::jmin (available / 2, available - frameLength));
+    std::vector<double> periods;
+    std::vector<float> normalised;
+
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        const int start = numFrames > 1 ? span * frame / (numFrames - 1) : 0;
+        const double period = estimatePeriod (mono.data() + start, energy.data() + start, window, minLag, maxLag, normalised);
+
+        if (period > 0.0)
+            periods.push_back (period);
+    }
+
+    // Most frames have to agree that there's a pitch at all
+    if ((int) periods.size() * 2 <= numFrames)
+        return {};
+
+    std::nth_element (periods.begin(), periods.begin() + (long) periods.size() / 2, periods.end());
+
+    Result result;
+    result.isPitched = true;
+    result.frequency = sampleRate / periods[periods.size() / 2];
+
+    const double note = 69.0 + 12.0 * std::log2 (result.frequency / 440.0);
+    result.noteNumber = juce::jlimit (0, 127, juce::roundToInt (note));
+    result.centsOffset = (float) ((note - result.noteNumber) * 100.0);
+
+    return result;
+}
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    PitchDetector.h
+    YIN fundamental frequency estimation, used to map samples with no note number in their name.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    de Cheveigné and Kawahara's YIN: the cumulative mean normalised difference
+    function of a few frames from the sustained part of the sample, the first
+    dip under the threshold, refined by parabolic interpolation. The frames'
+    estimates are combined by taking their median, so one frame caught on a
+    transient doesn't decide the note.
+
+    The difference function is computed from running energies and one dot
+    product per lag, four lags' worth of samples per SIMD operation.
+*/
+namespace PitchDetector
+{
+    constexpr double minFrequency = 27.5;   // A0
+    constexpr double maxFrequency = 4186.0; // C8
+    constexpr float threshold = 0.2f;
+    constexpr int numFrames = 5;
+
+    struct Result
+    {
+        bool isPitched = false;
+        double frequency = 0.0;
+        int noteNumber = 0;
+        float centsOffset = 0.0f; // of `frequency` from `noteNumber`, within +-50
+    };
+
+    /** Looks at the channels' sum from `analysisStart` on, i.e. after the attack. */
+    Result detect (const juce::AudioSampleBuffer& buffer, double sampleRate, int analysisStart);
+}
@@ -12,16 +12,29 @@
 //==============================================================================
 SpheringerAudioProcessorEditor::SpheringerAudioProcessorEditor (SpheringerAudioProcessor& p)
     : AudioProcessorEditor (&p),
-    keyboardComponent(p.keyboardState,juce::MidiKeyboardComponent::horizontalKeyboard),
+    mWaveformView(p.thumbnails),
+    keyboardComponent(keyboardState,juce::MidiKeyboardComponent::horizontalKeyboard),
     audioProcessor (p)
 {
     // Add load file button
     mLoadButton.onClick = [&]() { audioProcessor.loadFile(); };
     addAndMakeVisible(mLoadButton); // make button visible
     
-    // Link audio processor to keyboard state Make MIDI keyboard visible
-    p.keyboardState.addListener(this);
+   #if SPHERINGER_TRACING
+    mTraceButton.onClick = [&]() { audioProcessor.saveTrace(); };
+    addAndMakeVisible(mTraceButton);
+   #endif
+    
+    // Listen to our own keyboard state to forward clicks to the processor. Make MIDI keyboard visible
+    keyboardState.addListener(this);
     addAndMakeVisible(keyboardComponent);
+    
+    // Whatever queued up while no editor was open is stale now
+    audioProcessor.guiEvents.clear();
+    audioProcessor.guiConnected = true;
+    
+    addAndMakeVisible(mQuadMeter);
+    addAndMakeVisible(mWaveformView);
 
     
     // Add ADSR rotary sliders
@@ -41,11 +54,11 @@ SpheringerAudioProcessorEditor::SpheringerAudioProcessorEditor (SpheringerAudioP
     mDecaySlider.addListener(this);
     addAndMakeVisible(mDecaySlider);
     
-    // Sustain
+    // Sustain (a level, not a time)
     mSustainSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
     mSustainSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 50, 20);
-    mSustainSlider.setRange(0.01f, 5.0f, 0.01f);
-    mSustainSlider.setDoubleClickReturnValue(true, 1.0f); // default: 1.0s
+    mSustainSlider.setRange(0.0f, 1.0f, 0.01f);
+    mSustainSlider.setDoubleClickReturnValue(true, 1.0f); // default: full level
     mSustainSlider.addListener(this);
     addAndMakeVisible(mSustainSlider);
     
@@ -57,6 +70,12 @@ SpheringerAudioProcessorEditor::SpheringerAudioProcessorEditor (SpheringerAudioP
     mReleaseSlider.addListener(this);
     addAndMakeVisible(mReleaseSlider);
     
+    // Start the dials from the processor's current envelope
+    mAttackSlider.setValue(audioProcessor.getADSRParams().attack, juce::dontSendNotification);
+    mDecaySlider.setValue(audioProcessor.getADSRParams().decay, juce::dontSendNotification);
+    mSustainSlider.setValue(audioProcessor.getADSRParams().sustain, juce::dontSendNotification);
+    mReleaseSlider.setValue(audioProcessor.getADSRParams().release, juce::dontSendNotification);
+    
     
     // Add volume slider
     mVolumeSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
@@ -72,9 +91,36 @@ SpheringerAudioProcessorEditor::SpheringerAudioProcessorEditor (SpheringerAudioP
         audioProcessor.volume.setTargetValue(mVolumeSlider.getValue());
     };
     
+    // Dynamic layers follow the mod wheel / expression when ticked
+    mDynamicsToggle.setToggleState(audioProcessor.getDynamicsFromController(), juce::dontSendNotification);
+    mDynamicsToggle.onClick = [this]()
+    {
+        audioProcessor.setDynamicsFromController(mDynamicsToggle.getToggleState());
+    };
+    addAndMakeVisible(mDynamicsToggle);
+    
+    // Add voice spread sliders, in degrees
+    mKeySpreadSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
+    mKeySpreadSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 50, 20);
+    mKeySpreadSlider.setRange(0.0f, 360.0f, 1.0f);
+    mKeySpreadSlider.setDoubleClickReturnValue(true, 0.0f); // default: every key in front
+    addAndMakeVisible(mKeySpreadSlider);
+    
+    mRandomSpreadSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
+    mRandomSpreadSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, true, 50, 20);
+    mRandomSpreadSlider.setRange(0.0f, 360.0f, 1.0f);
+    mRandomSpreadSlider.setDoubleClickReturnValue(true, 0.0f);
+    addAndMakeVisible(mRandomSpreadSlider);
+    
+    // on spread value change
+    mKeySpreadSlider.onValueChange = mRandomSpreadSlider.onValueChange = [this]()
+    {
+        audioProcessor.setVoiceSpread(mKeySpreadSlider.getValue(), mRandomSpreadSlider.getValue());
+    };
+    
     ////////////// Font and UI =================================================================
     // Set UI window size
-    setSize (600, 400);
+    setSize (600, 500);
     
     // Set label texts for the sliders
     const auto fontSize = 10.0f;
@@ -93,7 +139,7 @@ SpheringerAudioProcessorEditor::SpheringerAudioProcessorEditor (SpheringerAudioP
     
     // Sustain
     mSustainLabel.setFont(fontSize);
-    mSustainLabel.setText("Sustain (s)", juce::NotificationType::dontSendNotification);
+    mSustainLabel.setText("Sustain", juce::NotificationType::dontSendNotification);
     mSustainLabel.setJustificationType(juce::Justification::centredTop);
     mSustainLabel.attachToComponent(&mSustainSlider, false);
     
@@ -109,11 +155,32 @@ SpheringerAudioProcessorEditor::SpheringerAudioProcessorEditor (SpheringerAudioP
     mVolumeLabel.setJustificationType(juce::Justification::centredTop);
     mVolumeLabel.attachToComponent(&mVolumeSlider, false);
     
+    // Spread
+    mKeySpreadLabel.setFont(fontSize);
+    mKeySpreadLabel.setText("Key spread", juce::NotificationType::dontSendNotification);
+    mKeySpreadLabel.setJustificationType(juce::Justification::centredTop);
+    mKeySpreadLabel.attachToComponent(&mKeySpreadSlider, false);
+    
+    mRandomSpreadLabel.setFont(fontSize);
+    mRandomSpreadLabel.setText("Random spread", juce::NotificationType::dontSendNotification);
+    mRandomSpreadLabel.setJustificationType(juce::Justification::centredTop);
+    mRandomSpreadLabel.attachToComponent(&mRandomSpreadSlider, false);
+    
+    // Diagnostics
+    mDiagnosticsLabel.setFont(fontSize);
+    mDiagnosticsLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(mDiagnosticsLabel);
+    
+    startTimerHz(FRAME_RATE_HZ);
+    
 
 }
 
 SpheringerAudioProcessorEditor::~SpheringerAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.guiConnected = false;
+    keyboardState.removeListener(this);
 }
 
 //==============================================================================
@@ -129,7 +196,11 @@ void SpheringerAudioProcessorEditor::paint (juce::Graphics& g)
 void SpheringerAudioProcessorEditor::resized()
 {
     // Set button size and position
-    mLoadButton.setBounds(getWidth()/2 - 100, getHeight()/3 - 30, 200, 60);
+    mLoadButton.setBounds(getWidth()/2 - 100, 92, 200, BUTTON_HEIGHT);
+    mDynamicsToggle.setBounds(getWidth()/2 + 110, 92, getWidth()/2 - 110 - MARGIN, BUTTON_HEIGHT);
+   #if SPHERINGER_TRACING
+    mTraceButton.setBounds(MARGIN, 92, getWidth()/2 - 110 - MARGIN, BUTTON_HEIGHT);
+   #endif
     
     // Set MIDI keyboard size and position
     juce::Rectangle<int> r = getLocalBounds();
@@ -138,13 +209,16 @@ void SpheringerAudioProcessorEditor::resized()
     float keybHeight = resizedKeybHeight > MAX_KEYB_HEIGHT ? MAX_KEYB_HEIGHT : resizedKeybHeight;
     keyboardComponent.setBounds (MARGIN, MARGIN, keybWidth, keybHeight);
     
+    // Waveform under the load button
+    mWaveformView.setBounds(MARGIN, 128, getWidth() - MARGIN * 2, 100);
+    
     
     // Set ADSR slider positions, values are relative
-    // Current window size: 600 * 400
+    // Current window size: 600 * 500
     const auto startX = 0.4f;
     const auto startY = 0.7f;
     const auto dialWidth = 0.15f;
-    const auto dialHeight = 0.225f;
+    const auto dialHeight = 0.18f;
     
     mAttackSlider.setBoundsRelative(startX, startY, dialWidth, dialHeight); // proportional x,y, height, width
     mDecaySlider.setBoundsRelative(startX + dialWidth, startY, dialWidth, dialHeight);
@@ -154,20 +228,90 @@ void SpheringerAudioProcessorEditor::resized()
     // Set volume slider position
     const auto startXX = 0.2f;
     mVolumeSlider.setBoundsRelative(startXX , startY, dialWidth, dialHeight);
+    
+    // Spread dials share the space left of the volume
+    mKeySpreadSlider.setBoundsRelative(0.0f, startY, startXX / 2, dialHeight);
+    mRandomSpreadSlider.setBoundsRelative(startXX / 2, startY, startXX / 2, dialHeight);
+    
+    // Meters between the load button and the dials
+    mQuadMeter.setBoundsRelative(0.2f, 0.47f, 0.6f, 0.17f);
+    
+    // Diagnostics along the bottom edge
+    mDiagnosticsLabel.setBounds(r.removeFromBottom(20).reduced(MARGIN, 0));
+}
+
+void SpheringerAudioProcessorEditor::timerCallback()
+{
+    // Everything the audio thread has queued since the last frame
+    for (GuiEvent event; audioProcessor.guiEvents.pop(event);)
+    {
+        if (event.type == GuiEvent::Type::meter)
+        {
+            mQuadMeter.addFrame(event.meter);
+            continue;
+        }
+        
+        const juce::ScopedValueSetter<bool> applying (isApplyingAudioEvents, true);
+        
+        if (event.note.isNoteOn)
+        {
+            keyboardState.noteOn(event.note.midiChannel, event.note.noteNumber, event.note.velocity);
+            mWaveformView.setNote(event.note.noteNumber, event.layer);
+        }
+        else
+            keyboardState.noteOff(event.note.midiChannel, event.note.noteNumber, event.note.velocity);
+    }
+    
+    // One repaint per frame at most, and only if the levels actually moved
+    mQuadMeter.tick();
+    
+    if (++frameCounter % DIAGNOSTICS_EVERY_N_FRAMES == 0)
+        updateDiagnostics();
+}
+
+void SpheringerAudioProcessorEditor::updateDiagnostics()
+{
+    const auto& diagnostics = audioProcessor.getDiagnostics();
+    
+    juce::String text;
+    text << "Voices " << diagnostics.activeVoices.load() << " / " << diagnostics.polyphonyLimit.load()
+         << "   CPU " << juce::roundToInt(diagnostics.cpuLoad.load() * 100.0f) << "%"
+         << "   Stolen " << (int) diagnostics.voicesStolen.load()
+         << " (" << (int) diagnostics.voicesStolenForCpu.load() << " for CPU)";
+    
+    const auto hits = diagnostics.cacheHits.load(), misses = diagnostics.cacheMisses.load();
+    text << "   Samples " << juce::roundToInt(diagnostics.residentSampleBytes.load() / (1024.0 * 1024.0)) << " MB"
+         << " (" << juce::roundToInt(diagnostics.lockedSampleBytes.load() / (1024.0 * 1024.0)) << " MB locked"
+         << (diagnostics.sampleLockLimitReached.load() ? ", at lock limit)" : ")")
+         << ", " << (int) hits << " hits / " << (int) misses << " misses"
+         << "   Trimmed " << juce::roundToInt(diagnostics.preprocessingBytesSaved.load() / (1024.0 * 1024.0)) << " MB";
+    
+    // Only while the output limiter is actually working
+    if (const auto reduction = diagnostics.limiterGainReductionDb.load(); reduction >= 0.1f)
+        text << "   Limiting " << juce::String(reduction, 1) << " dB";
+    
+    // Debug builds only: allocations or blocking calls caught inside processBlock
+    if (const auto violations = RealtimeGuard::getNumViolations())
+        text << "   RT violations " << (int) violations;
+    
+    mDiagnosticsLabel.setText(text, juce::dontSendNotification);
 }
 
 void SpheringerAudioProcessorEditor::handleNoteOn(juce::MidiKeyboardState *source, int midiChannel, int midiNoteNumber, float velocity)
 {
-    // should I write the play sound from here???
-    // no I don't think so - the midi messages are read into processBlock already
+    // Only clicks on the on-screen keyboard go to the processor, notes it told us about are already playing
+    if (! isApplyingAudioEvents)
+        audioProcessor.keyboardEvents.push({ midiChannel, midiNoteNumber, velocity, true });
 }
  
 void SpheringerAudioProcessorEditor::handleNoteOff(juce::MidiKeyboardState *source, int midiChannel, int midiNoteNumber, float velocity)
-{}
+{
+    if (! isApplyingAudioEvents)
+        audioProcessor.keyboardEvents.push({ midiChannel, midiNoteNumber, velocity, false });
+}
 
 void SpheringerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
 {
-    /*
     if (slider == &mAttackSlider)
     {
         audioProcessor.getADSRParams().attack = mAttackSlider.getValue();
@@ -184,8 +328,11 @@ void SpheringerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
     {
         audioProcessor.getADSRParams().release = mReleaseSlider.getValue();
     }
+    else
+    {
+        return; // volume has its own onValueChange
+    }
     
     // Update ADSR upon user input
     audioProcessor.updateADSR();
-    */
 }
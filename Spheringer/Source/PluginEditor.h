@@ -10,13 +10,16 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "QuadMeter.h"
+#include "WaveformView.h"
 
 //==============================================================================
 /**
 */
 class SpheringerAudioProcessorEditor  : public juce::AudioProcessorEditor,
                                         public juce::Slider::Listener,
-                                        public juce::MidiKeyboardState::Listener
+                                        public juce::MidiKeyboardState::Listener,
+                                        private juce::Timer
 {
 public:
     SpheringerAudioProcessorEditor (SpheringerAudioProcessor&);
@@ -34,8 +37,15 @@ public:
     void sliderValueChanged(juce::Slider* slider) override;
 
 private:
+    // Runs at a fixed frame rate: drains the audio thread's events, then repaints what changed
+    void timerCallback() override;
+    void updateDiagnostics();
+    
     // Create a button for file load
     juce::TextButton mLoadButton {"Load a sample library folder..."};
+   #if SPHERINGER_TRACING
+    juce::TextButton mTraceButton {"Save trace..."};
+   #endif
     
     // Create 4 rotary sliders for ADSR envelope customization
     // Create 4 labels for these sliders
@@ -47,9 +57,31 @@ private:
     juce::Slider mVolumeSlider;
     juce::Label mVolumeLabel;
     
+    // Voice placement: azimuth spread across the keyboard, and random spread per note
+    juce::Slider mKeySpreadSlider, mRandomSpreadSlider;
+    juce::Label mKeySpreadLabel, mRandomSpreadLabel;
+    
+    // Crossfade dynamic layers with CC 1 / CC 11 instead of picking one by velocity
+    juce::ToggleButton mDynamicsToggle {"Dynamics from CC 1 / 11"};
+    
+    // Voice count, CPU load and voice steals
+    juce::Label mDiagnosticsLabel;
+    
+    // Output levels and sound-field position
+    QuadMeter mQuadMeter;
+    
+    // Thumbnail of the zone that was played last, in the layer it was played in, with its sustain loop
+    WaveformView mWaveformView;
+    
     // Create MIDI keyboard visualization
+    // This state belongs to the GUI: the audio thread's notes arrive through the processor's guiEvents,
+    // and clicks on the keyboard go back through keyboardEvents
     juce::MidiKeyboardState keyboardState;
     juce::MidiKeyboardComponent keyboardComponent;
+    bool isApplyingAudioEvents = false; // so notes coming from the processor aren't sent straight back
+    int frameCounter = 0;
+    
+    static constexpr int FRAME_RATE_HZ = 30, DIAGNOSTICS_EVERY_N_FRAMES = 8;
     
     // GUI constants
     static const int MARGIN = 4, MAX_WINDOW_HEIGHT = 800, MAX_WINDOW_WIDTH = 1200 + 2 * MARGIN,
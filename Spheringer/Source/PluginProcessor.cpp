@@ -8,23 +8,41 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "MixBenchmark.h"
 
 //==============================================================================
 SpheringerAudioProcessor::SpheringerAudioProcessor()
      : AudioProcessor (BusesProperties()
-                       .withOutput ("Output1", juce::AudioChannelSet::quadraphonic(), true))
-                       
+                       .withOutput ("Output1", juce::AudioChannelSet::quadraphonic(), true)),
+       loader (thumbnails, diagnostics, [this] (int bank, SampleLibrary::Ptr newLibrary) { publishLibrary(bank, std::move(newLibrary)); })
 {
-    // allows plugin to use basic audio formats, e.g. .mp3, .wav, ...
-    mFormatManager.registerBasicFormats();
-    // Initialize MIDI keyboard state
-    keyboardState.reset();
-
+   #if SPHERINGER_MIX_BENCHMARK
+    juce::Logger::writeToLog (MixBenchmark::run().toString());
+   #endif
 }
 
 SpheringerAudioProcessor::~SpheringerAudioProcessor()
 {
-    mFormatReader = nullptr;
+}
+
+void SpheringerAudioProcessor::publishLibrary (int bank, SampleLibrary::Ptr newLibrary)
+{
+    // Picked up by the next block. The loader still holds a reference to whatever this replaces,
+    // so nothing gets freed on the audio thread.
+    RealtimeGuard::check ("publishLibrary");
+    const juce::SpinLock::ScopedLockType lock (libraryLock);
+    pendingLibraries[(size_t) bank] = std::move(newLibrary);
+    hasPendingLibraries = true;
+}
+
+void SpheringerAudioProcessor::selectProgram (int index)
+{
+    if (! juce::isPositiveAndBelow (index, numPrograms.load()))
+        return;
+    
+    currentProgram = index;
+    library = banks[(size_t) index];
+    loader.showBank (index);
 }
 
 //==============================================================================
@@ -50,27 +68,38 @@ bool SpheringerAudioProcessor::isMidiEffect() const
 
 double SpheringerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.3;
+    // After the last note-off: the release, then the limiter's lookahead. There's no reverb or delay to ring on.
+    const double sampleRate = getSampleRate();
+    const double lookaheadSeconds = sampleRate > 0.0 ? getLatencySamples() / sampleRate : 0.0;
+    
+    return juce::jmax (0.0f, adsrParams.release) + lookaheadSeconds;
 }
 
 int SpheringerAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return juce::jmax (1, programFolders.size());   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                                                    // so this should be at least 1, even if you're not really implementing programs.
 }
 
 int SpheringerAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    const int requested = requestedProgram.load();
+    return requested >= 0 ? requested : currentProgram.load();
 }
 
 void SpheringerAudioProcessor::setCurrentProgram (int index)
 {
+    if (! juce::isPositiveAndBelow (index, programFolders.size()))
+        return;
+    
+    requestedProgram = index;
+    loader.showBank (index);
 }
 
 const juce::String SpheringerAudioProcessor::getProgramName (int index)
 {
-    return {};
+    // Named after its folder
+    return programFolders[index].getFileName();
 }
 
 void SpheringerAudioProcessor::changeProgramName (int index, const juce::String& newName)
@@ -86,6 +115,30 @@ void SpheringerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerB
     // Reset volume value
     volume.reset(sampleRate, 0.02f); // ramp length in seconds: 0.02
     
+    // Allocate the voices' scratch space here rather than on the audio thread.
+    // Hosts switch to offline before preparing for a bounce, that's when the render threads are started.
+    voices.prepare (sampleRate, samplesPerBlock, getTotalNumOutputChannels(), isNonRealtime());
+    adsrChanged = true;
+    
+   #if SPHERINGER_INTERLEAVED_MIX
+    mixBus.setSize (samplesPerBlock);
+   #endif
+    
+    cpuBudget.prepare (sampleRate);
+    
+    // The limiter's lookahead delays everything, let the host compensate
+    limiter.prepare (sampleRate, samplesPerBlock);
+    setLatencySamples (limiter.getLatencySamples());
+    
+    meterAccumulator = {};
+    meterSamplesAccumulated = 0;
+    meterIntervalSamples = juce::roundToInt (sampleRate / meterRateHz);
+    
+    // Two meter intervals so at least one whole silent frame reaches the editor before the meters stop updating
+    idleAfterSamples = limiter.getLatencySamples() + 2 * meterIntervalSamples;
+    silentSamples = 0;
+    idle = false;
+    
     // Print host output channel number
     std::cout << "Host output channel count is: " << getChannelCountOfBus(false, 0) << std::endl;
 }
@@ -113,172 +166,403 @@ bool SpheringerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
 void SpheringerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-    
-    // In case we have more outputs than inputs, this code clears any output
-    // channels that didn't contain input data, (because these aren't
-    // guaranteed to be empty - they may contain garbage).
-    // This is here to avoid people getting screaming feedback
-    // when they first compile a plugin, but obviously you don't need to keep
-    // this code if your algorithm always overwrites all the output channels.
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-    
-    // Read MIDI message for keyboard visualization
-    keyboardState.processNextMidiBuffer (midiMessages, 0, buffer.getNumSamples(), true);
-
-    // Create an allocated quadData array to store buffer info and do DSP (gain volume)
-    // Check if output and buffer channel number match
-    if (buffer.getNumChannels() != totalNumOutputChannels)
-    {
-        DBG("Buffer and Output channel number don't match?!?! OMG");
-        std::cout << "Buffer and Output channel number don't match?!?! OMG" << std::endl;
-    }
-    else
-    {
-        
-        int numChannels = buffer.getNumChannels();
-        int numSamples = buffer.getNumSamples();
-        //std::cout << "Buffer channel#: " << numChannels << ", Buffer sample#: " << numSamples << std::endl;
-        
-        /*
-        //juce::AudioBuffer<float> tempQuadBuffer(quadData, numChannels, numSamples);
-        juce::AudioBuffer<float> tempQuadBuffer(numChannels, numSamples);
-        // let the buffer do the parsing automatically
-        mSampler.renderNextBlock(tempQuadBuffer, midiMessages, 0, buffer.getNumSamples());
     
-       // float* quadData = new float[numChannels * numSamples];
+    SPHERINGER_TRACE_AUDIO_THREAD ("Audio");
+    SPHERINGER_TRACE_SCOPE ("processBlock");
+    
+    // Bouncing offline: no deadline, so take the slower, better paths. Switches back by itself on the next live block.
+    const bool isOffline = isNonRealtime();
+    voices.setRenderQuality (isOffline ? RenderQuality::offline : RenderQuality::realtime);
+    
+    // Debug builds: flags any allocation, blocking lock or file access from here on
+    const RealtimeGuard::ScopedAudioCallback realtimeGuard (! isOffline);
+    
+    // The voices add into the buffer, so start from silence
+    buffer.clear();
+    
+    // Pick up envelope changes from the sliders
+    if (adsrChanged.load())
+    {
+        const juce::SpinLock::ScopedTryLockType adsrTryLock (adsrLock);
         
-        for (int channel = 0; channel < numChannels; ++channel)
+        if (adsrTryLock.isLocked())
         {
-            buffer.copyFrom(channel, 0, tempQuadBuffer, channel, 0, numSamples);
+            voices.setEnvelopeParameters (pendingADSR);
+            adsrChanged = false;
         }
-         */
+    }
+    
+    // Pick up reloaded libraries. If the loader is handing one over right now, it'll be there next block.
+    {
+        const juce::SpinLock::ScopedTryLockType libraryTryLock (libraryLock);
         
-        // Parse MIDI message here
-        for (const auto metadata : midiMessages)
+        if (libraryTryLock.isLocked() && hasPendingLibraries)
         {
-            // Read Midi message objects from MidiBuffer
-            const auto message = metadata.getMessage();
+            SPHERINGER_TRACE_SCOPE ("librarySwap");
             
-            // The transport source method does not care about Midi off events - as soon as the Midi on is triggered it play the audio file as a whole to its end. Kinda works with the current samples I have as they are not too long.
-            // Def will not working with looping samples, like the ambience singing.
-            
-            if (message.isNoteOn())
+            for (size_t bank = 0; bank < banks.size(); ++bank)
             {
-                isPlaying = true;
-                // play file with the same midi number
-                // std::map<int, juce::AudioSampleBuffer> audioBuffers;
-                currentNum = message.getNoteNumber();
-                
+                if (pendingLibraries[bank] != nullptr)
+                {
+                    std::swap(banks[bank], pendingLibraries[bank]);
+                    pendingLibraries[bank] = nullptr;
+                }
             }
             
-            if (message.isNoteOff() && isStopping) // let's do one note at a time
-            {
-                isPlaying = false;
-                currentPos = 0;
-                prevNum = 1000;
-            }
-                
+            hasPendingLibraries = false;
+            library = banks[(size_t) currentProgram.load()];
+        }
+    }
+    
+    // A program chosen by the host
+    const int hostProgram = requestedProgram.exchange (-1);
+    
+    if (hostProgram >= 0)
+        selectProgram (hostProgram);
+    
+    // Nothing to play and nothing left to come out: the cleared buffer is the whole block
+    if (isIdle (midiMessages))
+    {
+        if (! idle)
+            enterIdle();
+        
+        volume.skip (buffer.getNumSamples());
+        
+        // Same as the end of a rendered block: the plugin has no MIDI output
+        midiMessages.clear();
+        return;
+    }
+    
+    idle = false;
+    
+   #if SPHERINGER_INTERLEAVED_MIX
+    mixBus.clear (0, juce::jmin (mixBus.getNumFrames(), buffer.getNumSamples()));
+    mixBusStart = 0;
+   #endif
+    
+    // Bounce blocks wait on disk reads and aren't played in real time, so they'd only teach the budget the wrong cost
+    if (! isOffline)
+        cpuBudget.startBlock();
+    
+    // Shed voices before rendering if the last blocks say we can't afford them
+    updatePolyphonyLimit();
+    
+    // Notes from the on-screen keyboard start at the top of the block
+    for (NoteEvent event; keyboardEvents.pop (event);)
+        handleMidiEvent (event.isNoteOn ? juce::MidiMessage::noteOn (event.midiChannel, event.noteNumber, event.velocity)
+                                        : juce::MidiMessage::noteOff (event.midiChannel, event.noteNumber, event.velocity));
+    
+    // Parse MIDI message here, rendering up to each event so note-ons and offs are sample accurate
+    int renderedUpTo = 0;
+    
+    for (const auto metadata : midiMessages)
+    {
+        renderVoices (buffer, renderedUpTo, metadata.samplePosition - renderedUpTo);
+        renderedUpTo = metadata.samplePosition;
+        
+        // Read Midi message objects from MidiBuffer
+        handleMidiEvent (metadata.getMessage());
+    }
+    
+    const int numVoicesRendered = voices.getNumActiveVoices();
+    renderVoices (buffer, renderedUpTo, buffer.getNumSamples() - renderedUpTo);
+    finishVoiceMix (buffer);
+    
+    // Adjust output volume in dB
+    if (volume.isSmoothing())
+    {
+        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        {
+            const auto gain = juce::Decibels::decibelsToGain (volume.getNextValue());
+            
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                buffer.getWritePointer (channel)[sample] *= gain;
+        }
+    }
+    else
+    {
+        buffer.applyGain (juce::Decibels::decibelsToGain (volume.getTargetValue()));
+    }
+    
+    {
+        SPHERINGER_TRACE_SCOPE ("limiter");
+        limiter.process (buffer);
+    }
+    
+    updateMeters (buffer);
+    
+    if (! isOffline)
+        cpuBudget.endBlock (buffer.getNumSamples(), numVoicesRendered);
+    
+    const int numActiveVoices = voices.getNumActiveVoices();
+    silentSamples = numActiveVoices > 0 ? 0 : silentSamples + buffer.getNumSamples();
+    
+    if (! isOffline)
+        diagnostics.cpuLoad.store (cpuBudget.getLoad(), std::memory_order_relaxed);
+    
+    diagnostics.activeVoices.store (numActiveVoices, std::memory_order_relaxed);
+    diagnostics.polyphonyLimit.store (voices.getPolyphonyLimit(), std::memory_order_relaxed);
+    diagnostics.limiterGainReductionDb.store (-juce::Decibels::gainToDecibels (limiter.getMinimumGain()), std::memory_order_relaxed);
+    
+    // Clear MidiBuffer as the plugin does not have MIDI output
+    midiMessages.clear();
+}
+
+bool SpheringerAudioProcessor::isIdle (const juce::MidiBuffer& midiMessages) const noexcept
+{
+    return silentSamples >= idleAfterSamples
+        && midiMessages.isEmpty()
+        && keyboardEvents.isEmpty()
+        && voices.getNumActiveVoices() == 0;
+}
+
+void SpheringerAudioProcessor::enterIdle()
+{
+    idle = true;
+    
+    // Whatever the limiter still holds is silence by now; start the next note from unity gain
+    limiter.reset();
+    
+    diagnostics.cpuLoad.store (0.0f, std::memory_order_relaxed);
+    diagnostics.activeVoices.store (0, std::memory_order_relaxed);
+    diagnostics.limiterGainReductionDb.store (0.0f, std::memory_order_relaxed);
+}
+
+void SpheringerAudioProcessor::renderVoices (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+   #if SPHERINGER_INTERLEAVED_MIX
+    const int busSize = mixBus.getNumFrames();
+    
+    if (busSize == 0)
+        return;
+    
+    // Hosts shouldn't send more than samplesPerBlock, but if one does, flush the bus and carry on further down the block
+    while (numSamples > 0)
+    {
+        if (startSample - mixBusStart >= busSize)
+        {
+            mixBus.copyTo (buffer, mixBusStart, 0, busSize);
+            mixBusStart += busSize;
+            mixBus.clear (0, juce::jmin (busSize, buffer.getNumSamples() - mixBusStart));
         }
         
+        const int numThisTime = juce::jmin (numSamples, mixBusStart + busSize - startSample);
+        voices.renderNextBlock (mixBus, startSample - mixBusStart, numThisTime);
+        startSample += numThisTime;
+        numSamples -= numThisTime;
+    }
+   #else
+    voices.renderNextBlock (buffer, startSample, numSamples);
+   #endif
+}
+
+void SpheringerAudioProcessor::finishVoiceMix (juce::AudioBuffer<float>& buffer)
+{
+   #if SPHERINGER_INTERLEAVED_MIX
+    const int numFrames = juce::jmin (mixBus.getNumFrames(), buffer.getNumSamples() - mixBusStart);
+    
+    if (numFrames > 0)
+        mixBus.copyTo (buffer, mixBusStart, 0, numFrames);
+   #else
+    juce::ignoreUnused (buffer);
+   #endif
+}
 
+void SpheringerAudioProcessor::handleMidiEvent (const juce::MidiMessage& message)
+{
+    if (message.isController())
+        handleController (message.getControllerNumber(), message.getControllerValue());
+    
+    if (message.isProgramChange())
+        selectProgram (message.getProgramChangeNumber());
+    
+    if (! message.isNoteOnOrOff())
+        return;
+    
+    int playedLayer = -1;
+    
+    if (message.isNoteOn())
+    {
+        SPHERINGER_TRACE_SCOPE ("noteOn");
         
-        // Playback from loaded audio buffer storage
-        if (isPlaying)
+        // play file with the same midi number, if there is one
+        if (const auto* layers = library != nullptr ? library->getLayers (message.getNoteNumber()) : nullptr)
         {
-            // File loader
-            const auto iterator = audioBuffers.find(currentNum); // this iterator exists only within the loop
-            // make sure the iterator find a key in the mapping folder matching the input MIDI number
-            // if no match: the return value is std::map::end
-            if (iterator == audioBuffers.end()) // no match
+            // Either every layer, for the controller to crossfade between, or the one nearest the velocity
+            SampleLibrary::Layers toPlay;
+            
+            if (dynamicsFromController.load())
             {
-                isPlaying = false;
+                toPlay = *layers;
+                playedLayer = getControllerLayer (*layers, voices.getDynamics());
             }
-                
-            
-            if (iterator != audioBuffers.end() && iterator->first != prevNum)
+            else
             {
-                
-                prevNum = currentNum;
-                std::cout << "MIDI number triggered is: " << iterator->first << std::endl;
-                // ->first returns the key (the first column)
-                // ->second return the data mapped to the key
-                // create a pointer? or AudioSampleBuffer? to hold the data
-                tempBuffer.clear();
-                tempBuffer = iterator->second; // only reload when change in MIDI number
-                
+                playedLayer = getVelocityLayer (*layers, message.getFloatVelocity());
+                toPlay[(size_t) playedLayer] = (*layers)[(size_t) playedLayer];
             }
             
+            // A miss still plays, just late: the voice waits until the loader has the samples in memory
+            const bool allResident = std::all_of (toPlay.begin(), toPlay.end(), [] (const SampleZone::Ptr& zone) { return zone == nullptr || zone->isResident(); });
+            ++(allResident ? diagnostics.cacheHits : diagnostics.cacheMisses);
+            loader.requestZone (currentProgram.load(), message.getNoteNumber());
             
-            int tempSamples = tempBuffer.getNumSamples();
+            diagnostics.voicesStolen += (juce::uint32) voices.noteOn (message.getNoteNumber(), toPlay, getNoteAzimuth (message.getNoteNumber()));
             
-            std::cout << "tempSamples = " << tempSamples << ", currentPos = " << currentPos << std::endl;
-        
-            for (int channel = 0; channel < numChannels; ++channel)
-            {
-                auto* channelData = buffer.getWritePointer (channel);
-                auto* tempData = tempBuffer.getReadPointer (channel);
-
-                for (int sample = 0; sample < numSamples; ++sample)
-                {
-                    if (currentPos + sample < tempSamples)
-                        channelData[sample] = tempData[sample + currentPos];
-                    else
-                    {
-                        channelData[sample] = 0;
-                        isStopping = true; // flag that file is played to end
-                    }
-                    
-                    // Adjust output volume in dB
-                    channelData[sample] *= juce::Decibels::decibelsToGain(volume.getNextValue());
-                        
-                }
-                
-            }
-            
-            // reset to new playhead position
-            currentPos += numSamples;
+            // ...except in a bounce, which has no deadline: load it now, the voice starts from the top in this block
+            if (! allResident && isNonRealtime())
+                loader.makeResidentNow (toPlay);
         }
-        
+    }
+    else
+    {
+        // Looped zones keep sustaining until the release stage has faded out
+        voices.noteOff (message.getNoteNumber());
+    }
+    
+    // Keyboard display in the editor
+    if (guiConnected.load (std::memory_order_relaxed))
+    {
+        GuiEvent event;
+        event.note = { message.getChannel(), message.getNoteNumber(), message.getFloatVelocity(), message.isNoteOn() };
+        event.layer = playedLayer;
+        guiEvents.push (event);
+    }
+}
 
+void SpheringerAudioProcessor::handleController (int controllerNumber, int value)
+{
+    const auto normalised = (float) value / 127.0f;
     
+    if (controllerNumber == azimuthController)
+        spatialControls.azimuth = (64 - value) / 64.0f * juce::MathConstants<float>::pi; // centre is the front, like pan
+    else if (controllerNumber == elevationController)
+        spatialControls.elevation = normalised * juce::MathConstants<float>::halfPi;
+    else if (controllerNumber == widthController)
+        spatialControls.width = normalised;
+    else if (controllerNumber == modWheelController || controllerNumber == expressionController)
+    {
+        // Held notes follow too, when they have more than one layer
+        voices.setDynamics (normalised);
+        return;
     }
+    else
+        return;
     
-    // Clear MidiBuffer as the plugin does not have MIDI output
-    midiMessages.clear();
+    voices.setSharedSpatialPosition (spatialControls);
+}
 
-    // This is the place where you'd normally do the guts of your plugin's
-    // audio processing...
-    // Make sure to reset the state if your inner loop is processing
-    // the samples and the outer loop is handling the channels.
-    // Alternatively, you can process the samples with the channels
-    // interleaved by keeping the same state.
-    
-    // let's add in a volume slider!
-    /*
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+int SpheringerAudioProcessor::getVelocityLayer (const SampleLibrary::Layers& layers, float velocity)
+{
+    // Softest layer for the lowest third of the velocity range, and so on, falling back to the nearest recorded one
+    const int wanted = juce::jlimit (0, DynamicLayer::numLayers - 1, (int) (velocity * DynamicLayer::numLayers));
+    for (int distance = 0; distance < DynamicLayer::numLayers; ++distance)
     {
-        auto* channelData = buffer.getWritePointer (channel);
+        if (wanted - distance >= 0 && layers[(size_t) (wanted - distance)] != nullptr)
+            return wanted - distance;
+        
+        if (wanted + distance < DynamicLayer::numLayers && layers[(size_t) (wanted + distance)] != nullptr)
+            return wanted + distance;
+    }
+    
+    return wanted;
+}
+
+int SpheringerAudioProcessor::getControllerLayer (const SampleLibrary::Layers& layers, float dynamics)
+{
+    // Voices crossfade across the recorded layers only, so that's what the controller position is relative to
+    std::array<int, DynamicLayer::numLayers> recorded {};
+    int numRecorded = 0;
+    
+    for (int layer = 0; layer < DynamicLayer::numLayers; ++layer)
+        if (layers[(size_t) layer] != nullptr)
+            recorded[(size_t) numRecorded++] = layer;
+    
+    if (numRecorded == 0)
+        return DynamicLayer::mezzoforte;
+    
+    return recorded[(size_t) juce::roundToInt (juce::jlimit (0.0f, 1.0f, dynamics) * (float) (numRecorded - 1))];
+}
 
-        // ..do something to the data...
+void SpheringerAudioProcessor::setDynamicsFromController (bool shouldFollowController)
+{
+    dynamicsFromController = shouldFollowController;
+}
+
+float SpheringerAudioProcessor::getNoteAzimuth (int noteNumber)
+{
+    // Low notes on the left, high notes on the right, as seen from the keyboard
+    const auto fromKey = -keyboardSpread.load() * ((float) noteNumber - 63.5f) / 127.0f;
+    const auto fromRandom = randomSpread.load() * (random.nextFloat() - 0.5f);
+    
+    return fromKey + fromRandom;
+}
+
+void SpheringerAudioProcessor::setVoiceSpread (float keyboardSpreadDegrees, float randomSpreadDegrees)
+{
+    keyboardSpread = juce::degreesToRadians (keyboardSpreadDegrees);
+    randomSpread = juce::degreesToRadians (randomSpreadDegrees);
+}
+
+void SpheringerAudioProcessor::updateMeters (const juce::AudioBuffer<float>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin (buffer.getNumChannels(), numMeterChannels);
+    
+    // peak keeps the maximum, rms keeps the running sum of squares until the frame is sent
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& peak = meterAccumulator.peak[(size_t) channel];
+        peak = juce::jmax (peak, buffer.getMagnitude (channel, 0, numSamples));
+        meterAccumulator.rms[(size_t) channel] += juce::square (buffer.getRMSLevel (channel, 0, numSamples)) * (float) numSamples;
     }
-    */
     
-    /*
-    // tempBuffer checked! everything is correctly loaded - 0504 checkpoint
-    // check if the audio buffer is correctly loaded into processBlock
-    for (int channel = 0; channel < tempBuffer.getNumChannels(); ++channel)
+    meterSamplesAccumulated += numSamples;
+    
+    if (meterSamplesAccumulated < meterIntervalSamples)
+        return;
+    
+    if (guiConnected.load (std::memory_order_relaxed))
     {
-        float* channelData = tempBuffer.getWritePointer(channel);
-        for (int sample = 0; sample < tempBuffer.getNumSamples(); ++sample)
-        {
-            std::cout << "Channel#: " << channel << ", Sample#: " << sample << ", Data: " << channelData[sample] << std::endl;
-        }
+        GuiEvent event;
+        event.type = GuiEvent::Type::meter;
+        event.meter = meterAccumulator;
+        
+        for (auto& rms : event.meter.rms)
+            rms = std::sqrt (rms / (float) meterSamplesAccumulated);
+        
+        guiEvents.push (event);
     }
-    */
+    
+    meterAccumulator = {};
+    meterSamplesAccumulated = 0;
+}
 
+void SpheringerAudioProcessor::updatePolyphonyLimit()
+{
+    // Offline a slow block only makes the bounce take longer, it never glitches
+    if (isNonRealtime())
+    {
+        voices.setPolyphonyLimit (VoicePool::maxPolyphony);
+        return;
+    }
+    
+    const int affordable = cpuBudget.getAffordableVoices();
+    const int limit = voices.getPolyphonyLimit();
+    
+    if (affordable < limit)
+    {
+        voices.setPolyphonyLimit (affordable);
+        
+        const auto numStolen = (juce::uint32) voices.enforcePolyphonyLimit();
+        diagnostics.voicesStolen += numStolen;
+        diagnostics.voicesStolenForCpu += numStolen;
+    }
+    else if (affordable > limit + 1)
+    {
+        // Headroom is back: one voice at a time, so we don't bounce straight back over budget
+        voices.setPolyphonyLimit (limit + 1);
+    }
 }
 
 //==============================================================================
@@ -308,6 +592,32 @@ void SpheringerAudioProcessor::setStateInformation (const void* data, int sizeIn
 
 
 //==============================================================================
+void SpheringerAudioProcessor::addProgram (const juce::File& folder)
+{
+    // Once every bank is taken, the folder replaces the current program instead
+    const int bank = programFolders.size() < LibraryLoader::maxBanks ? programFolders.size() : getCurrentProgram();
+    
+    programFolders.set(bank, folder);
+    numPrograms = programFolders.size();
+    loader.loadFolder(bank, folder);
+    
+    setCurrentProgram(bank);
+    updateHostDisplay (ChangeDetails().withProgramChanged (true));
+}
+
+void SpheringerAudioProcessor::saveTrace()
+{
+    juce::FileChooser chooser {"Save the trace as Chrome / Perfetto JSON...", juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("Spheringer trace.json"), "*.json"};
+    
+    if (! chooser.browseForFileToSave(true))
+        return;
+    
+    const auto result = Trace::saveChromeJson(chooser.getResult());
+    
+    if (result.failed())
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Trace not saved", result.getErrorMessage());
+}
+
 void SpheringerAudioProcessor::loadFile()
 {
     /*
@@ -322,48 +632,9 @@ void SpheringerAudioProcessor::loadFile()
     //chooser = std::make_unique<juce::FileChooser> ("Please load a file", juce::File{}, "*.wav");
     
     // Returns True if user choose directory; read directory via .getResult() method
+    // Decoding, loop detection and thumbnails all happen on the loader thread, so the editor stays responsive
     if (chooser.browseForDirectory())
-    {
-        juce::File folder = chooser.getResult(); // get and store file?
-        std::cout << folder.getFullPathName() << std::endl;
-        
-        juce::Array<juce::File> audioFiles; // pre-load files allocate to this array
-        folder.findChildFiles(audioFiles, juce::File::TypesOfFileToFind::findFiles, true, "*.wav"); // search for .wav files
-        
-        // Initialize a reader to use for loading all files
-        std::unique_ptr <juce::AudioFormatReader> mFormatReader;
-        
-        
-        for (auto file : audioFiles)
-        {
-            std::cout << "File loaded pre-reader! Filename: " << file.getFileName() << std::endl;
-            mFormatReader.reset(mFormatManager.createReaderFor(file));
-            
-            if (mFormatReader != nullptr)
-            {
-                // Print number of channels
-                int numChannels = mFormatReader->numChannels;
-                int numSamples = static_cast<int>(mFormatReader->lengthInSamples); //int64 to int32
-                std::cout << "File loaded! Filename: " << file.getFileName() << ", Number of channels: " << numChannels << std::endl;
-                
-                // Create a buffer for file
-                //juce::AudioBuffer<float> fileBuffer(numChannels, numSamples);
-                juce::AudioSampleBuffer fileBuffer(numChannels, numSamples);
-                //auto fileBuffer = std::make_unique<juce::AudioBuffer<float>>(numChannels, numSamples);
-                
-                // Read audio data and separate channel
-                // set the `useReaderLeftChannel` and `useReaderRightChannel` to false!!!!
-                mFormatReader->read(&fileBuffer, 0, numSamples, 0, false, false);
-                
-                audioBuffers[file.getFileNameWithoutExtension().getTrailingIntValue()] = std::move(fileBuffer);
-                // if files are named like ****_C4_60.wav that would be very helpful!!
-     
-            }
-        }
-        
-        
-        
-    }
+        addProgram(chooser.getResult());
     
     /*
     if (chooser.browseForFileToOpen())
@@ -409,6 +680,17 @@ void SpheringerAudioProcessor::loadFile()
 
 }
 
+void SpheringerAudioProcessor::updateADSR()
+{
+    // Sustain is a level, not a time
+    adsrParams.sustain = juce::jlimit(0.0f, 1.0f, adsrParams.sustain);
+    
+    RealtimeGuard::check ("updateADSR");
+    const juce::SpinLock::ScopedLockType lock (adsrLock);
+    pendingADSR = adsrParams;
+    adsrChanged = true;
+}
+
 
 //==============================================================================
 // This creates new instances of the plugin..
@@ -9,6 +9,16 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SampleZone.h"
+#include "VoicePool.h"
+#include "CpuBudget.h"
+#include "Diagnostics.h"
+#include "AudioGuiBridge.h"
+#include "LibraryLoader.h"
+#include "ThumbnailCache.h"
+#include "RealtimeGuard.h"
+#include "QuadLimiter.h"
+#include "Trace.h"
 
 //==============================================================================
 /**
@@ -56,38 +66,140 @@ public:
     // Load file ===================================================================
     void loadFile();
     
-    // Playback State =====================================================================
-    //bool playState = false;
-    int currentPos = 0; // current playhead position
-    int currentNum = -1; // current MIDI number, for storage
-    int prevNum = 1000; // previously triggered MIDI number
-    bool isPlaying = false;
-    bool isStopping = false;
+    // Programs ====================================================================
+    // Every program is a library folder. All of them are loaded in the background, so a program change
+    // from the host or over MIDI switches sounds straight away. Message thread.
+    void addProgram (const juce::File& folder);
+    
+    // Tracing =====================================================================
+    // Asks where to save the timeline of the last few thousand events on every thread (SPHERINGER_TRACING builds)
+    void saveTrace();
+    
+    // Envelope ====================================================================
+    // Edit the parameters on the message thread, then call updateADSR() to hand them to the voice
+    juce::ADSR::Parameters& getADSRParams() { return adsrParams; }
+    void updateADSR();
+    
+    // CPU budget ==================================================================
+    // Voices are stolen when the projected render cost goes over this fraction of the buffer period
+    void setCpuBudget (float fractionOfBufferPeriod) { cpuBudget.setBudget (fractionOfBufferPeriod); }
+    
+    // Voice placement =============================================================
+    // Spreads notes around the listener: lowest to highest key across keyboardSpread,
+    // plus a random offset of up to half of randomSpread either way. Both in degrees.
+    void setVoiceSpread (float keyboardSpreadDegrees, float randomSpreadDegrees);
+    
+    // Notes with several dynamic layers: either pick one by velocity (the default), or play them all
+    // and crossfade between adjacent layers with the mod wheel or expression (CC 1 / CC 11)
+    void setDynamicsFromController (bool shouldFollowController);
+    bool getDynamicsFromController() const noexcept { return dynamicsFromController.load(); }
+    
+    // Sample cache ================================================================
+    // Decoded sample data is kept under this many bytes; zones that don't fit are loaded when played
+    void setSampleMemoryBudget (juce::int64 bytes) { loader.setMemoryBudget (bytes); }
+    
+    const Diagnostics& getDiagnostics() const noexcept { return diagnostics; }
     
     // Volume value
     juce::SmoothedValue<float> volume {0.0f};
     
-    //std::unique_ptr<juce::AudioBuffer<float>> tempBuffer; // shorter tha 3 seconds
-    juce::AudioSampleBuffer tempBuffer;
-    
     
     // UI ==========================================================================
-    juce::MidiKeyboardState keyboardState;
+    // Audio thread -> editor: note events for the keyboard display and meter frames, drained on the editor's timer
+    SpscFifo<GuiEvent, 1024> guiEvents;
+    
+    // Editor -> audio thread: notes played on the on-screen keyboard
+    SpscFifo<NoteEvent, 256> keyboardEvents;
+    
+    // Set while an editor is open, so the audio thread doesn't fill guiEvents for nobody
+    std::atomic<bool> guiConnected {false};
+    
+    // Waveform summaries of the loaded zones, filled in by the loader thread
+    ThumbnailCache thumbnails;
 
 private:
     //==============================================================================
-    juce::AudioFormatManager mFormatManager;
-    juce::AudioFormatReader* mFormatReader {nullptr};
-    
     //std::unique_ptr<juce::AudioFormatReaderSource> playSource;
     //juce::AudioTransportSource transportSource;
 
 
     
     // Buffer for storing pre-loaded files after reader input
-    // Map MIDI number (int) to audio files in the buffer
-    //std::map<int, juce::AudioBuffer<float>> audioBuffers;
-    std::map<int, juce::AudioSampleBuffer> audioBuffers;
+    // Map MIDI number (int) to audio files in the buffer, together with their sustain loops
+    // Audio thread only: one library per program, updated from pendingLibraries at the top of a block
+    std::array<SampleLibrary::Ptr, LibraryLoader::maxBanks> banks;
+    SampleLibrary::Ptr library; // the current program's
+    
+    // Handed over by the loader thread. Voices keep playing the zones they started with.
+    std::array<SampleLibrary::Ptr, LibraryLoader::maxBanks> pendingLibraries;
+    bool hasPendingLibraries = false;
+    juce::SpinLock libraryLock;
+    void publishLibrary (int bank, SampleLibrary::Ptr newLibrary);
+    
+    // Programs: switching is only a pointer swap, voices that are still ringing finish on the old bank
+    void selectProgram (int index);
+    juce::Array<juce::File> programFolders; // message thread
+    std::atomic<int> numPrograms {0}, currentProgram {0};
+    std::atomic<int> requestedProgram {-1}; // by the host, picked up at the top of the next block
+    
+    // Playback
+    VoicePool voices;
+    void handleMidiEvent (const juce::MidiMessage& message);
+    
+    // Voices mix into interleaved frames at the same offsets as in the block, split into channels once at the end
+    void renderVoices (juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+    void finishVoiceMix (juce::AudioBuffer<float>& buffer);
+   #if SPHERINGER_INTERLEAVED_MIX
+    QuadFrameBuffer mixBus;
+    int mixBusStart = 0; // block offset of the bus's first frame
+   #endif
+    
+    // Voice placement: every voice is turned to azimuth (CC 10) and tilted up (CC 16) with a width (CC 17),
+    // on top of its own azimuth from the key it was played on
+    void handleController (int controllerNumber, int value);
+    float getNoteAzimuth (int noteNumber);
+    SpatialPosition spatialControls;
+    std::atomic<float> keyboardSpread {0.0f}, randomSpread {0.0f}; // radians
+    juce::Random random;
+    static constexpr int azimuthController = 10, elevationController = 16, widthController = 17;
+    
+    // Dynamic layers
+    static int getVelocityLayer (const SampleLibrary::Layers& layers, float velocity);
+    static int getControllerLayer (const SampleLibrary::Layers& layers, float dynamics); // the one nearest the controller
+    std::atomic<bool> dynamicsFromController {false};
+    static constexpr int modWheelController = 1, expressionController = 11;
+    
+    // Adaptive polyphony: shed voices when the render path gets too expensive, win them back when it calms down
+    void updatePolyphonyLimit();
+    CpuBudget cpuBudget;
+    
+    // Keeps the summed output under -1 dBTP however loud the volume and polyphony get
+    QuadLimiter limiter;
+    
+    // Idle: no voices, no MIDI, and the last sound has come out of the limiter and reached the meters.
+    // Blocks are then just cleared until the next event, so a session full of silent instances costs next to nothing.
+    bool isIdle (const juce::MidiBuffer& midiMessages) const noexcept;
+    void enterIdle();
+    int silentSamples = 0; // since a voice was last active
+    int idleAfterSamples = 0;
+    bool idle = false;
+    
+    Diagnostics diagnostics;
+    
+    // Output levels, collected over a few blocks before going to the editor
+    void updateMeters (const juce::AudioBuffer<float>& buffer);
+    MeterFrame meterAccumulator;
+    int meterSamplesAccumulated = 0, meterIntervalSamples = 0;
+    static constexpr double meterRateHz = 60.0;
+    
+    // Envelope handed over from the message thread
+    juce::ADSR::Parameters adsrParams {0.1f, 0.1f, 1.0f, 0.1f};
+    juce::ADSR::Parameters pendingADSR {adsrParams};
+    juce::SpinLock adsrLock;
+    std::atomic<bool> adsrChanged {true};
+    
+    // Declared last so its thread is stopped before anything it publishes into goes away
+    LibraryLoader loader;
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpheringerAudioProcessor)
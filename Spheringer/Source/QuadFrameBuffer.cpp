@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    QuadFrameBuffer.cpp
+
+  ==============================================================================
+*/
+
+#include "QuadFrameBuffer.h"
+
+//==============================================================================
+void QuadFrameBuffer::setSize (int numFramesToHold)
+{
+    numFrames = juce::jmax (0, numFramesToHold);
+    samples.assign ((size_t) numFrames * numChannels, 0.0f);
+    data = samples.data();
+}
+
+void QuadFrameBuffer::setDataToReferTo (float* frames, int numFramesToReferTo) noexcept
+{
+    std::vector<float>().swap (samples);
+    data = frames;
+    numFrames = juce::jmax (0, numFramesToReferTo);
+}
+
+void QuadFrameBuffer::clear (int startFrame, int numFramesToClear) noexcept
+{
+    jassert (startFrame >= 0 && startFrame + numFramesToClear <= numFrames);
+    juce::FloatVectorOperations::clear (getFrame (startFrame), numFramesToClear * numChannels);
+}
+
+void QuadFrameBuffer::addFrom (const QuadFrameBuffer& source, int destinationStart, int sourceStart, int numFramesToAdd) noexcept
+{
+    jassert (destinationStart + numFramesToAdd <= numFrames && sourceStart + numFramesToAdd <= source.numFrames);
+    juce::FloatVectorOperations::add (getFrame (destinationStart), source.getFrame (sourceStart), numFramesToAdd * numChannels);
+}
+
+void QuadFrameBuffer::copyFrom (const juce::AudioSampleBuffer& source, int sourceStart, int startFrame, int numFramesToCopy) noexcept
+{
+    jassert (startFrame + numFramesToCopy <= numFrames && sourceStart + numFramesToCopy <= source.getNumSamples());
+
+    const int numSourceChannels = source.getNumChannels();
+    const float* channels[numChannels] = {};
+
+    if (numSourceChannels == 0)
+    {
+        clear (startFrame, numFramesToCopy);
+        return;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        channels[channel] = source.getReadPointer (juce::jmin (channel, numSourceChannels - 1), sourceStart);
+
+    float* frame = getFrame (startFrame);
+
+    for (int i = 0; i < numFramesToCopy; ++i, frame += numChannels)
+    {
+        frame[0] = channels[0][i];
+        frame[1] = channels[1][i];
+        frame[2] = channels[2][i];
+        frame[3] = channels[3][i];
+    }
+}
+
+void QuadFrameBuffer::copyTo (juce::AudioSampleBuffer& destination, int destinationStart, int startFrame, int numFramesToCopy) const noexcept
+{
+    jassert (startFrame + numFramesToCopy <= numFrames);
+
+    const int numDestinationChannels = juce::jmin (numChannels, destination.getNumChannels());
+    float* channels[numChannels] = {};
+
+    for (int channel = 0; channel < numDestinationChannels; ++channel)
+        channels[channel] = destination.getWritePointer (channel, destinationStart);
+
+    const float* frame = getFrame (startFrame);
+
+    if (numDestinationChannels == numChannels)
+    {
+        // The quad layout this plugin always runs in
+        for (int i = 0; i < numFramesToCopy; ++i, frame += numChannels)
+        {
+            channels[0][i] = frame[0];
+            channels[1][i] = frame[1];
+            channels[2][i] = frame[2];
+            channels[3][i] = frame[3];
+        }
+
+        return;
+    }
+
+    for (int i = 0; i < numFramesToCopy; ++i, frame += numChannels)
+        for (int channel = 0; channel < numDestinationChannels; ++channel)
+            channels[channel][i] = frame[channel];
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    QuadFrameBuffer.h
+    Interleaved L, R, Ls, Rs frames: one SIMD register per frame.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdFloat4.h"
+
+// Voices mix into interleaved quad frames rather than straight into the planar
+// output buffer. Zones are stored as quad frames either way; this only picks
+// the bus. Define it to 0 or 1 in the project settings to override.
+#ifndef SPHERINGER_INTERLEAVED_MIX
+ #define SPHERINGER_INTERLEAVED_MIX 1
+#endif
+
+// Logs MixBenchmark's planar vs interleaved timings when the plugin is created
+#ifndef SPHERINGER_MIX_BENCHMARK
+ #define SPHERINGER_MIX_BENCHMARK 0
+#endif
+
+//==============================================================================
+/**
+    The planar output buffer makes every voice write four separate channel
+    streams. Here a voice adds a whole frame with one load, multiply-add and
+    store, and the frames are split back into channels once per block.
+
+    Zones keep their samples in the same layout, so a voice reads one frame
+    with one load too. Their frames live in a SampleArena block rather than
+    in the buffer's own storage.
+*/
+class QuadFrameBuffer
+{
+public:
+    //==============================================================================
+    static constexpr int numChannels = 4;
+
+    QuadFrameBuffer() = default;
+
+    // Allocates and clears. Not for the audio thread.
+    void setSize (int numFramesToHold);
+    int getNumFrames() const noexcept { return numFrames; }
+
+    // Uses frames stored elsewhere instead of its own, which are freed. The caller keeps them alive.
+    void setDataToReferTo (float* frames, int numFramesToReferTo) noexcept;
+
+    float* getFrame (int index) noexcept             { return data + (size_t) index * numChannels; }
+    const float* getFrame (int index) const noexcept { return data + (size_t) index * numChannels; }
+
+    void clear (int startFrame, int numFramesToClear) noexcept;
+    void addFrom (const QuadFrameBuffer& source, int destinationStart, int sourceStart, int numFramesToAdd) noexcept;
+
+    // Interleaves the first four channels of the source. A source with fewer repeats its last channel in the rest.
+    void copyFrom (const juce::AudioSampleBuffer& source, int sourceStart, int startFrame, int numFramesToCopy) noexcept;
+
+    // Deinterleaves into the first four channels of the destination, overwriting them
+    void copyTo (juce::AudioSampleBuffer& destination, int destinationStart, int startFrame, int numFramesToCopy) const noexcept;
+
+private:
+    //==============================================================================
+    std::vector<float> samples;
+    float* data = nullptr; // samples.data(), unless referring to frames stored elsewhere
+    int numFrames = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QuadFrameBuffer)
+};
+
+#if SPHERINGER_INTERLEAVED_MIX
+ using MixBus = QuadFrameBuffer;
+#else
+ using MixBus = juce::AudioSampleBuffer;
+#endif
@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    QuadLimiter.cpp
+
+  ==============================================================================
+*/
+
+#include "QuadLimiter.h"
+
+//==============================================================================
+QuadLimiter::TruePeakDetector::TruePeakDetector()
+{
+    // Windowed-sinc interpolator at 4x, split into its four phases. Each phase is
+    // normalised to unity gain so a DC level reads the same on every phase.
+    // Centred on a sample, so phase 0 is that sample and phases 1-3 fall a quarter,
+    // a half and three quarters of a sample after it, `delay` samples back.
+    constexpr int length = numPhases * tapsPerPhase;
+    constexpr double centre = length / 2;
+
+    for (int phase = 0; phase < numPhases; ++phase)
+    {
+        double sum = 0.0;
+
+        for (int tap = 0; tap < tapsPerPhase; ++tap)
+        {
+            const int i = tap * numPhases + phase;
+            const double x = (i - centre) / numPhases;
+            const double sinc = x == 0.0 ? 1.0 : std::sin (juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+            const double window = 0.5 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * i / length);
+
+            taps[phase][tap] = (float) (sinc * window);
+            sum += taps[phase][tap];
+        }
+
+        for (auto& tap : taps[phase])
+            tap = (float) (tap / sum);
+    }
+
+    reset();
+}
+
+void QuadLimiter::TruePeakDetector::reset() noexcept
+{
+    std::fill (&history[0][0], &history[0][0] + 2 * tapsPerPhase * numChannels, 0.0f);
+    position = 0;
+}
+
+float QuadLimiter::TruePeakDetector::push (SimdFloat4 frame) noexcept
+{
+    frame.store (history[position]);
+    frame.store (history[position + tapsPerPhase]);
+    position = (position + 1) % tapsPerPhase;
+
+    // history[position + tapsPerPhase - 1] is the newest frame, history[position] the oldest
+    const float (*frames)[numChannels] = history + position;
+
+    // The sample itself, then the three points in between
+    auto peak = SimdFloat4::load (frames[tapsPerPhase - 1 - delay]).abs();
+
+    for (int phase = 1; phase < numPhases; ++phase)
+    {
+        auto sum = SimdFloat4::broadcast (0.0f);
+
+        for (int tap = 0; tap < tapsPerPhase; ++tap)
+            sum = sum.multiplyAdd (SimdFloat4::broadcast (taps[phase][tap]), SimdFloat4::load (frames[tapsPerPhase - 1 - tap]));
+
+        peak = peak.max (sum.abs());
+    }
+
+    return peak.horizontalMax();
+}
+
+//==============================================================================
+void QuadLimiter::SlidingMax::prepare (int windowLength)
+{
+    length = juce::jmax (1, windowLength);
+    values.assign ((size_t) length, 0.0f);
+    suffixMax.assign ((size_t) length, 0.0f);
+    prefixMax = 0.0f;
+    position = 0;
+}
+
+float QuadLimiter::SlidingMax::push (float value) noexcept
+{
+    // The window is the start of the current block plus the end of the previous one
+    values[(size_t) position] = value;
+    prefixMax = position == 0 ? value : juce::jmax (prefixMax, value);
+
+    const float previousBlockTail = position + 1 < length ? suffixMax[(size_t) position + 1] : 0.0f;
+    const float result = juce::jmax (prefixMax, previousBlockTail);
+
+    // Block complete: its suffix maxima become the tails for the next block
+    if (++position == length)
+    {
+        position = 0;
+        suffixMax[(size_t) length - 1] = values[(size_t) length - 1];
+
+        for (int i = length - 1; --i >= 0;)
+            suffixMax[(size_t) i] = juce::jmax (values[(size_t) i], suffixMax[(size_t) i + 1]);
+    }
+
+    return result;
+}
+
+//==============================================================================
+void QuadLimiter::Boxcar::prepare (int length, float initialValue)
+{
+    values.assign ((size_t) juce::jmax (1, length), initialValue);
+    sum = (double) initialValue * (double) values.size();
+    position = 0;
+}
+
+float QuadLimiter::Boxcar::push (float value) noexcept
+{
+    sum += value - values[(size_t) position];
+    values[(size_t) position] = value;
+
+    if (++position == (int) values.size())
+        position = 0;
+
+    return (float) (sum / (double) values.size());
+}
+
+//==============================================================================
+void QuadLimiter::prepare (double sampleRate, int maximumBlockSize)
+{
+    ceiling = juce::Decibels::decibelsToGain (ceilingDb);
+    releaseCoefficient = (float) (1.0 - std::exp (-1.0 / (releaseSeconds * sampleRate)));
+
+    lookahead = juce::jmax (1, juce::roundToInt (lookaheadSeconds * sampleRate));
+    latency = lookahead + TruePeakDetector::delay;
+    maxChunk = juce::jmax (1, maximumBlockSize);
+
+    delayLine.setSize (numChannels, latency + maxChunk);
+    gains.assign ((size_t) maxChunk, 1.0f);
+
+    reset();
+}
+
+void QuadLimiter::reset()
+{
+    detector.reset();
+
+    // A peak has to be held from the moment it is detected until the last sample of the moving average has passed it
+    peakHold.prepare (lookahead + 1);
+    smoother.prepare (lookahead, 1.0f);
+
+    releasedGain = minimumGain = 1.0f;
+    delayLine.clear();
+}
+
+void QuadLimiter::process (juce::AudioSampleBuffer& buffer) noexcept
+{
+    minimumGain = 1.0f;
+
+    // Hosts may hand us bigger blocks than announced in prepareToPlay
+    for (int start = 0; start < buffer.getNumSamples(); start += maxChunk)
+        processChunk (buffer, start, juce::jmin (maxChunk, buffer.getNumSamples() - start));
+}
+
+void QuadLimiter::processChunk (juce::AudioSampleBuffer& buffer, int startSample, int numSamples) noexcept
+{
+    const int numBufferChannels = juce::jmin (numChannels, buffer.getNumChannels());
+
+    // New audio goes in behind the history; missing channels stay silent
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        if (channel < numBufferChannels)
+            delayLine.copyFrom (channel, latency, buffer, channel, startSample, numSamples);
+        else
+            delayLine.clear (channel, latency, numSamples);
+    }
+
+    const float* in[numChannels];
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        in[channel] = delayLine.getReadPointer (channel, latency);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float peak = peakHold.push (detector.push (SimdFloat4::fromValues (in[0][i], in[1][i], in[2][i], in[3][i])));
+        const float required = peak > ceiling ? ceiling / peak : 1.0f;
+
+        // Down at once, back up slowly, then smoothed over the lookahead
+        releasedGain = required < releasedGain ? required : releasedGain + (required - releasedGain) * releaseCoefficient;
+        gains[(size_t) i] = smoother.push (releasedGain);
+    }
+
+    // Out of the front of the delay line, through the gain
+    for (int channel = 0; channel < numBufferChannels; ++channel)
+        juce::FloatVectorOperations::multiply (buffer.getWritePointer (channel, startSample), delayLine.getReadPointer (channel), gains.data(), numSamples);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* samples = delayLine.getWritePointer (channel);
+        std::memmove (samples, samples + numSamples, (size_t) latency * sizeof (float));
+    }
+
+    minimumGain = juce::jmin (minimumGain, juce::FloatVectorOperations::findMinimum (gains.data(), numSamples));
+}
@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    QuadLimiter.h
+    True-peak lookahead limiter, linked across the four output channels.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdFloat4.h"
+
+//==============================================================================
+/**
+    All four channels share one gain, so limiting never moves the image.
+
+    Per sample: the peak of all channels at 4x oversampling (one SIMD lane per
+    channel), its maximum over the lookahead window, an instant-attack /
+    exponential-release gain, and a moving average over the lookahead so the
+    gain is already down when the peak comes out of the delay line. Every step
+    is O(1) per sample, so the cost per block is fixed.
+*/
+class QuadLimiter
+{
+public:
+    //==============================================================================
+    static constexpr int numChannels = 4;
+
+    void prepare (double sampleRate, int maximumBlockSize);
+    void reset();
+
+    // In place. Output is delayed by getLatencySamples().
+    void process (juce::AudioSampleBuffer& buffer) noexcept;
+
+    int getLatencySamples() const noexcept { return latency; }
+
+    // Lowest gain applied during the last process() call
+    float getMinimumGain() const noexcept  { return minimumGain; }
+
+    static constexpr float ceilingDb = -1.0f;
+    static constexpr double lookaheadSeconds = 0.002;
+    static constexpr double releaseSeconds = 0.08;
+
+private:
+    //==============================================================================
+    // 4x oversampled peak of the last few frames, 8 taps per phase
+    class TruePeakDetector
+    {
+    public:
+        static constexpr int numPhases = 4, tapsPerPhase = 8;
+        static constexpr int delay = tapsPerPhase / 2; // the peak returned belongs to the frame this many samples ago
+
+        TruePeakDetector();
+        void reset() noexcept;
+        float push (SimdFloat4 frame) noexcept;
+
+    private:
+        float taps[numPhases][tapsPerPhase];
+        float history[2 * tapsPerPhase][numChannels]; // written twice, so the last tapsPerPhase frames are always contiguous
+        int position = 0;
+    };
+
+    // Maximum over the last windowLength values in O(1) amortised per value (van Herk / Gil-Werman)
+    class SlidingMax
+    {
+    public:
+        void prepare (int windowLength);
+        float push (float value) noexcept;
+
+    private:
+        std::vector<float> values, suffixMax;
+        float prefixMax = 0.0f;
+        int length = 1, position = 0;
+    };
+
+    // Moving average over the lookahead
+    class Boxcar
+    {
+    public:
+        void prepare (int length, float initialValue);
+        float push (float value) noexcept;
+
+    private:
+        std::vector<float> values;
+        double sum = 0.0;
+        int position = 0;
+    };
+
+    void processChunk (juce::AudioSampleBuffer& buffer, int startSample, int numSamples) noexcept;
+
+    TruePeakDetector detector;
+    SlidingMax peakHold;
+    Boxcar smoother;
+
+    float ceiling = 1.0f, releaseCoefficient = 0.0f, releasedGain = 1.0f, minimumGain = 1.0f;
+    int lookahead = 0, latency = 0, maxChunk = 0;
+
+    juce::AudioSampleBuffer delayLine; // latency samples of history, then the current chunk
+    std::vector<float> gains;
+
+    friend class QuadLimiterTests;
+};
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    QuadMeter.cpp
+
+  ==============================================================================
+*/
+
+#include "QuadMeter.h"
+
+namespace
+{
+    // Per-tick decay of the displayed levels, roughly 20 dB/s at 30 fps
+    constexpr float fallFactor = 0.86f;
+
+    // Changes smaller than this aren't worth a repaint
+    constexpr float repaintThreshold = 0.002f;
+
+    // Quad speaker layout, azimuth in degrees clockwise from front, same order as the output channels
+    constexpr std::array<float, numMeterChannels> speakerAzimuths { -45.0f, 45.0f, -135.0f, 135.0f };
+    const std::array<const char*, numMeterChannels> channelNames { "L", "R", "Ls", "Rs" };
+
+    float toMeterPosition (float gain)
+    {
+        // -60 dB .. 0 dB on a linear dB scale
+        return juce::jlimit (0.0f, 1.0f, 1.0f + juce::Decibels::gainToDecibels (gain, -60.0f) / 60.0f);
+    }
+}
+
+//==============================================================================
+QuadMeter::QuadMeter()
+{
+    setOpaque (false);
+}
+
+void QuadMeter::addFrame (const MeterFrame& frame) noexcept
+{
+    // Several audio blocks can arrive per GUI frame: keep the loudest of each
+    for (int channel = 0; channel < numMeterChannels; ++channel)
+    {
+        pending.peak[(size_t) channel] = juce::jmax (pending.peak[(size_t) channel], frame.peak[(size_t) channel]);
+        pending.rms[(size_t) channel] = juce::jmax (pending.rms[(size_t) channel], frame.rms[(size_t) channel]);
+    }
+
+    hasPending = true;
+}
+
+void QuadMeter::tick()
+{
+    bool changed = false;
+
+    for (size_t channel = 0; channel < (size_t) numMeterChannels; ++channel)
+    {
+        const auto update = [&changed] (float& shownLevel, float newLevel)
+        {
+            const auto level = juce::jmax (newLevel, shownLevel * fallFactor);
+            changed = changed || std::abs (level - shownLevel) > repaintThreshold;
+            shownLevel = level < 1.0e-4f ? 0.0f : level;
+        };
+
+        update (shown.peak[channel], hasPending ? pending.peak[channel] : 0.0f);
+        update (shown.rms[channel], hasPending ? pending.rms[channel] : 0.0f);
+    }
+
+    pending = {};
+    hasPending = false;
+
+    if (changed)
+        repaint();
+}
+
+//==============================================================================
+void QuadMeter::paint (juce::Graphics& g)
+{
+    auto area = getLocalBounds().toFloat();
+    const auto fieldSize = juce::jmin (area.getHeight(), area.getWidth() * 0.5f);
+
+    paintSoundField (g, area.removeFromRight (fieldSize).reduced (4.0f));
+    paintBars (g, area.reduced (4.0f));
+}
+
+void QuadMeter::paintBars (juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    const auto labelHeight = 12.0f;
+    const auto barWidth = area.getWidth() / (float) numMeterChannels;
+
+    g.setFont (10.0f);
+
+    for (size_t channel = 0; channel < (size_t) numMeterChannels; ++channel)
+    {
+        auto column = area.removeFromLeft (barWidth).reduced (2.0f, 0.0f);
+        const auto label = column.removeFromBottom (labelHeight);
+
+        g.setColour (juce::Colours::black.withAlpha (0.4f));
+        g.fillRect (column);
+
+        const auto rmsHeight = column.getHeight() * toMeterPosition (shown.rms[channel]);
+        g.setColour (juce::Colours::limegreen);
+        g.fillRect (column.withTop (column.getBottom() - rmsHeight));
+
+        const auto peakY = column.getBottom() - column.getHeight() * toMeterPosition (shown.peak[channel]);
+        g.setColour (shown.peak[channel] >= 1.0f ? juce::Colours::red : juce::Colours::yellow);
+        g.drawLine (column.getX(), peakY, column.getRight(), peakY, 1.5f);
+
+        g.setColour (juce::Colours::white);
+        g.drawText (channelNames[channel], label, juce::Justification::centred, false);
+    }
+}
+
+void QuadMeter::paintSoundField (juce::Graphics& g, juce::Rectangle<float> area) const
+{
+    const auto radius = area.getWidth() * 0.5f - 4.0f;
+    const auto centre = area.getCentre();
+
+    g.setColour (juce::Colours::white.withAlpha (0.3f));
+    g.drawEllipse (area.withSizeKeepingCentre (radius * 2.0f, radius * 2.0f), 1.0f);
+
+    // Energy-weighted centroid of the speaker directions
+    float x = 0.0f, y = 0.0f, total = 0.0f;
+
+    for (size_t channel = 0; channel < (size_t) numMeterChannels; ++channel)
+    {
+        const auto azimuth = juce::degreesToRadians (speakerAzimuths[channel]);
+        const auto speakerX = centre.x + radius * std::sin (azimuth);
+        const auto speakerY = centre.y - radius * std::cos (azimuth);
+        const auto energy = juce::square (shown.rms[channel]);
+
+        g.setColour (juce::Colours::white.withAlpha (0.3f + 0.7f * toMeterPosition (shown.rms[channel])));
+        g.fillEllipse (speakerX - 3.0f, speakerY - 3.0f, 6.0f, 6.0f);
+
+        x += energy * std::sin (azimuth);
+        y += energy * std::cos (azimuth);
+        total += energy;
+    }
+
+    if (total <= 0.0f)
+        return;
+
+    // Fully in one speaker lands on the rim, evenly spread lands in the middle
+    const auto dotX = centre.x + radius * x / total;
+    const auto dotY = centre.y - radius * y / total;
+
+    g.setColour (juce::Colours::orange);
+    g.fillEllipse (dotX - 5.0f, dotY - 5.0f, 10.0f, 10.0f);
+}
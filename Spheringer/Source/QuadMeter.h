@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    QuadMeter.h
+    Peak/RMS bars for the four output channels, plus a sound-field view that
+    shows where the energy sits between the speakers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AudioGuiBridge.h"
+
+//==============================================================================
+class QuadMeter  : public juce::Component
+{
+public:
+    QuadMeter();
+
+    // Feed every frame drained from the audio thread; frames are merged until the next tick()
+    void addFrame (const MeterFrame& frame) noexcept;
+
+    // Call once per GUI frame: applies the meter ballistics and repaints only if something moved
+    void tick();
+
+    void paint (juce::Graphics&) override;
+
+private:
+    void paintBars (juce::Graphics&, juce::Rectangle<float> area) const;
+    void paintSoundField (juce::Graphics&, juce::Rectangle<float> area) const;
+
+    MeterFrame pending, shown;
+    bool hasPending = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QuadMeter)
+};
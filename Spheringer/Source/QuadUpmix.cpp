@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    QuadUpmix.cpp
+
+  ==============================================================================
+*/
+
+#include "QuadUpmix.h"
+
+namespace
+{
+    struct VelvetFilter
+    {
+        std::vector<int> delays;
+        std::vector<float> gains;
+    };
+
+    // One per rear channel
+    using Decorrelators = std::array<VelvetFilter, 2>;
+
+    VelvetFilter design (double sampleRate, juce::int64 seed)
+    {
+        juce::Random random (seed);
+        VelvetFilter filter;
+
+        // One tap at a random position inside each grid segment
+        const double segment = sampleRate / QuadUpmix::tapsPerSecond;
+        const int numTaps = juce::jmax (1, juce::roundToInt (QuadUpmix::filterSeconds * QuadUpmix::tapsPerSecond));
+        const float decayPerTap = juce::Decibels::decibelsToGain (QuadUpmix::lastTapDb / (float) juce::jmax (1, numTaps - 1));
+
+        double energy = 0.0;
+        float envelope = 1.0f;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            const auto gain = (random.nextBool() ? envelope : -envelope);
+            filter.delays.push_back ((int) (tap * segment + random.nextDouble() * (segment - 1.0)));
+            filter.gains.push_back (gain);
+
+            energy += (double) gain * gain;
+            envelope *= decayPerTap;
+        }
+
+        // Same energy out as in, so a rear is as loud as the front it was made from
+        const auto normalise = (float) (1.0 / std::sqrt (energy));
+
+        for (auto& gain : filter.gains)
+            gain *= normalise;
+
+        return filter;
+    }
+
+    const Decorrelators& getDecorrelators (double sampleRate)
+    {
+        static juce::CriticalSection lock;
+        static std::map<double, Decorrelators> designed;
+
+        const juce::ScopedLock sl (lock);
+        auto iterator = designed.find (sampleRate);
+
+        if (iterator == designed.end())
+            iterator = designed.emplace (sampleRate, Decorrelators { design (sampleRate, 0x51), design (sampleRate, 0x52) }).first;
+
+        return iterator->second;
+    }
+
+    // A handful of sparse taps, so one vectorised multiply-add over the whole sample per tap
+    void decorrelate (const VelvetFilter& filter, const float* source, float* destination, int numSamples)
+    {
+        juce::FloatVectorOperations::clear (destination, numSamples);
+
+        for (size_t tap = 0; tap < filter.delays.size(); ++tap)
+        {
+            const int delay = filter.delays[tap];
+
+            if (delay < numSamples)
+                juce::FloatVectorOperations::addWithMultiply (destination + delay, source, filter.gains[tap], numSamples - delay);
+        }
+    }
+}
+
+//==============================================================================
+void QuadUpmix::apply (juce::AudioSampleBuffer& buffer, double sampleRate)
+{
+    const int numSourceChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+
+    if (numSourceChannels < 1 || numSourceChannels > 2)
+        return;
+
+    const auto& decorrelators = getDecorrelators (sampleRate);
+
+    buffer.setSize (4, numSamples, true);
+
+    // Mono: the same to both fronts. Stereo: left and right behind themselves.
+    const int rightSource = numSourceChannels == 2 ? 1 : 0;
+
+    decorrelate (decorrelators[0], buffer.getReadPointer (0), buffer.getWritePointer (2), numSamples);
+    decorrelate (decorrelators[1], buffer.getReadPointer (rightSource), buffer.getWritePointer (3), numSamples);
+
+    if (numSourceChannels == 1)
+        buffer.copyFrom (1, 0, buffer, 0, 0, numSamples);
+
+    // The spatialiser's old spread: equal power, a quarter per channel for mono, half per side for stereo
+    buffer.applyGain (numSourceChannels == 1 ? 0.5f : juce::MathConstants<float>::sqrt2 * 0.5f);
+}
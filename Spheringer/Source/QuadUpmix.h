@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    QuadUpmix.h
+    Load-time upmix of mono and stereo samples to L, R, Ls, Rs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Every zone ends up with four channels, so the voices and the spatialiser
+    only ever deal with quad sources.
+
+    The source stays in front at the levels the spatialiser used to spread it
+    with. The rears get copies through velvet-noise decorrelators: sparse FIR
+    filters of a few dozen randomly placed, exponentially decaying +-1 taps,
+    which are flat in energy but incoherent with the fronts and each other. So
+    the rears fill in the space around the listener instead of pulling a
+    phantom image between front and back.
+
+    The filters are designed once per sample rate, from fixed seeds, so a zone
+    read back from disk after eviction comes out exactly the same. Run it
+    before the loop crossfade is baked, so the rears loop as seamlessly as the
+    fronts.
+*/
+namespace QuadUpmix
+{
+    constexpr double filterSeconds = 0.03;
+    constexpr double tapsPerSecond = 1000.0;
+    constexpr float lastTapDb = -30.0f; // decay of the taps over the filter length
+
+    /** Grows mono and stereo buffers to four channels. Anything else is left alone. */
+    void apply (juce::AudioSampleBuffer& buffer, double sampleRate);
+}
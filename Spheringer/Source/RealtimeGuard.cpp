@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+#include <cstdlib>
+#include <new>
+
+#if SPHERINGER_REALTIME_GUARD
+
+namespace
+{
+    thread_local bool inAudioCallback = false;
+    std::atomic<juce::uint32> numViolations {0};
+}
+
+//==============================================================================
+RealtimeGuard::ScopedAudioCallback::ScopedAudioCallback (bool isRealtime) noexcept
+    : wasActive (inAudioCallback)
+{
+    if (isRealtime)
+        inAudioCallback = true;
+}
+
+RealtimeGuard::ScopedAudioCallback::~ScopedAudioCallback() noexcept
+{
+    inAudioCallback = wasActive;
+}
+
+bool RealtimeGuard::isAudioCallbackActive() noexcept
+{
+    return inAudioCallback;
+}
+
+juce::uint32 RealtimeGuard::getNumViolations() noexcept
+{
+    return numViolations.load();
+}
+
+void RealtimeGuard::reportViolation (const char* what)
+{
+    ++numViolations;
+
+    // Reporting allocates too, so step outside the callback while doing it
+    const juce::ScopedValueSetter<bool> outside (inAudioCallback, false);
+
+    juce::Logger::writeToLog (juce::String ("Real-time violation in the audio callback: ") + what + "\n"
+                                + juce::SystemStats::getStackBacktrace());
+    jassertfalse;
+}
+
+//==============================================================================
+// Everything the plugin allocates goes through here, containers included
+void* operator new (std::size_t size)
+{
+    RealtimeGuard::check ("operator new");
+
+    if (auto* memory = std::malloc (size > 0 ? size : 1))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    return operator new (size);
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeGuard::check ("operator new");
+    return std::malloc (size > 0 ? size : 1);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new (size, tag);
+}
+
+void operator delete (void* memory) noexcept
+{
+    if (memory != nullptr)
+        RealtimeGuard::check ("operator delete");
+
+    std::free (memory);
+}
+
+void operator delete[] (void* memory) noexcept                        { operator delete (memory); }
+void operator delete (void* memory, std::size_t) noexcept             { operator delete (memory); }
+void operator delete[] (void* memory, std::size_t) noexcept           { operator delete (memory); }
+void operator delete (void* memory, const std::nothrow_t&) noexcept   { operator delete (memory); }
+void operator delete[] (void* memory, const std::nothrow_t&) noexcept { operator delete (memory); }
+
+#endif
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.h
+    Debug-build checks for work that must never happen inside processBlock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// On in debug builds; define it to 0 or 1 in the project settings to override
+#ifndef SPHERINGER_REALTIME_GUARD
+ #if JUCE_DEBUG
+  #define SPHERINGER_REALTIME_GUARD 1
+ #else
+  #define SPHERINGER_REALTIME_GUARD 0
+ #endif
+#endif
+
+//==============================================================================
+/**
+    processBlock marks its thread with a ScopedAudioCallback. While it is alive,
+    every global operator new/delete is reported, and so is every call to
+    check() - which the code that blocks or touches the file system makes
+    before doing so.
+
+    A report asserts and logs a stack trace, so a violation stops a debug
+    session right where it happened. Only C++ allocations are caught: plain
+    malloc() and locks inside JUCE or the host are out of reach here. The test
+    runner in Tests catches those too on Linux, see RealtimeInterposer.
+*/
+namespace RealtimeGuard
+{
+   #if SPHERINGER_REALTIME_GUARD
+    struct ScopedAudioCallback
+    {
+        // Offline renders have no deadline, so pass false to leave the thread unmarked
+        explicit ScopedAudioCallback (bool isRealtime = true) noexcept;
+        ~ScopedAudioCallback() noexcept;
+
+        bool wasActive;
+    };
+
+    bool isAudioCallbackActive() noexcept;
+    void reportViolation (const char* what);
+
+    // Number of violations since the plugin was loaded
+    juce::uint32 getNumViolations() noexcept;
+
+    inline void check (const char* what)
+    {
+        if (isAudioCallbackActive())
+            reportViolation (what);
+    }
+   #else
+    struct ScopedAudioCallback { explicit ScopedAudioCallback (bool = true) noexcept {} };
+
+    inline bool isAudioCallbackActive() noexcept     { return false; }
+    inline juce::uint32 getNumViolations() noexcept  { return 0; }
+    inline void check (const char*) {}
+   #endif
+}
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    SampleArena.cpp
+
+  ==============================================================================
+*/
+
+#include "SampleArena.h"
+
+#if SPHERINGER_SAMPLE_ARENA
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+SampleArena::SampleArena()
+{
+   #if SPHERINGER_SAMPLE_ARENA
+    pageSize = (size_t) sysconf (_SC_PAGESIZE);
+
+    // Huge pages only line up if the arena starts on a 2 MB boundary, so round it up
+    // from a slightly larger reservation
+    constexpr size_t hugePageSize = (size_t) 2 << 20;
+    const size_t mappedBytes = reservedBytes + (SPHERINGER_ARENA_HUGE_PAGES ? hugePageSize : 0);
+
+    auto* mapped = mmap (nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+
+    if (mapped == MAP_FAILED)
+        return;
+
+    mapping = mapped;
+    mappingSize = mappedBytes;
+    base = static_cast<char*> (mapped);
+
+   #if SPHERINGER_ARENA_HUGE_PAGES && JUCE_LINUX
+    base += (hugePageSize - reinterpret_cast<std::uintptr_t> (base) % hugePageSize) % hugePageSize;
+    madvise (base, reservedBytes, MADV_HUGEPAGE);
+   #endif
+
+    capacity = reservedBytes;
+    freeBlocks[0] = capacity;
+   #endif
+}
+
+SampleArena::~SampleArena()
+{
+   #if SPHERINGER_SAMPLE_ARENA
+    // Every allocation holds the arena, so nothing is left in it by now
+    if (mapping != nullptr)
+        munmap (mapping, mappingSize);
+   #endif
+}
+
+std::shared_ptr<SampleArena> SampleArena::getShared()
+{
+    static std::mutex mutex;
+    static std::weak_ptr<SampleArena> shared;
+
+    const std::lock_guard<std::mutex> lockGuard (mutex);
+    auto arena = shared.lock();
+
+    if (arena == nullptr)
+    {
+        arena.reset (new SampleArena());
+        shared = arena;
+    }
+
+    return arena;
+}
+
+//==============================================================================
+SampleArena::Allocation SampleArena::moveIntoArena (QuadFrameBuffer& frames)
+{
+    const int numFrames = frames.getNumFrames();
+    const auto numBytes = (size_t) QuadFrameBuffer::numChannels * (size_t) numFrames * sizeof (float);
+
+    if (base == nullptr || numBytes == 0)
+        return {};
+
+    Allocation allocation;
+    allocation.size = (numBytes + pageSize - 1) / pageSize * pageSize;
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        // First fit
+        const auto block = std::find_if (freeBlocks.begin(), freeBlocks.end(), [&] (const auto& entry) { return entry.second >= allocation.size; });
+
+        if (block == freeBlocks.end())
+            return {};
+
+        allocation.offset = block->first;
+
+        if (block->second > allocation.size)
+            freeBlocks[block->first + allocation.size] = block->second - allocation.size;
+
+        freeBlocks.erase (block);
+    }
+
+    allocation.arena = shared_from_this();
+    auto* data = base + allocation.offset;
+
+   #if SPHERINGER_SAMPLE_ARENA
+    // Locking faults every page in, so the copy below doesn't take a fault per page either
+    if (! lockLimitReached.load())
+    {
+        allocation.locked = mlock (data, allocation.size) == 0;
+
+        if (allocation.locked)
+            lockedBytes += (juce::int64) allocation.size;
+        else
+            lockLimitReached = true;
+    }
+   #endif
+
+    auto* samples = reinterpret_cast<float*> (data);
+    juce::FloatVectorOperations::copy (samples, frames.getFrame (0), numFrames * QuadFrameBuffer::numChannels);
+
+    frames.setDataToReferTo (samples, numFrames);
+    return allocation;
+}
+
+void SampleArena::free (size_t offset, size_t size, bool wasLocked) noexcept
+{
+   #if SPHERINGER_SAMPLE_ARENA
+    auto* data = base + offset;
+
+    if (wasLocked)
+    {
+        munlock (data, size);
+        lockedBytes -= (juce::int64) size;
+
+        // There's room under the limit again
+        lockLimitReached = false;
+    }
+
+    // Give the pages back, the address space stays reserved
+   #if JUCE_MAC
+    madvise (data, size, MADV_FREE);
+   #else
+    madvise (data, size, MADV_DONTNEED);
+   #endif
+   #endif
+
+    const juce::ScopedLock sl (lock);
+
+    // Merge with the free neighbours on either side
+    auto next = freeBlocks.lower_bound (offset);
+
+    if (next != freeBlocks.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = freeBlocks.erase (next);
+    }
+
+    if (next != freeBlocks.begin())
+    {
+        const auto previous = std::prev (next);
+
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+
+    freeBlocks[offset] = size;
+}
+
+//==============================================================================
+SampleArena::Allocation::Allocation (Allocation&& other) noexcept
+    : arena (std::move (other.arena)), offset (other.offset), size (other.size), locked (other.locked)
+{
+    other.arena = nullptr;
+}
+
+SampleArena::Allocation& SampleArena::Allocation::operator= (Allocation&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        arena = std::move (other.arena);
+        offset = other.offset;
+        size = other.size;
+        locked = other.locked;
+        other.arena = nullptr;
+    }
+
+    return *this;
+}
+
+SampleArena::Allocation::~Allocation()
+{
+    release();
+}
+
+void SampleArena::Allocation::release() noexcept
+{
+    if (arena != nullptr)
+    {
+        arena->free (offset, size, locked);
+        arena = nullptr;
+    }
+}
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    SampleArena.h
+    One large block of address space for decoded samples, locked in RAM.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "QuadFrameBuffer.h"
+
+// Resident samples live in the arena rather than in their own heap blocks.
+// Define it to 0 or 1 in the project settings to override.
+#ifndef SPHERINGER_SAMPLE_ARENA
+ #if JUCE_MAC || JUCE_LINUX
+  #define SPHERINGER_SAMPLE_ARENA 1
+ #else
+  #define SPHERINGER_SAMPLE_ARENA 0
+ #endif
+#endif
+
+// Asks the kernel for transparent huge pages on the arena (Linux only)
+#ifndef SPHERINGER_ARENA_HUGE_PAGES
+ #define SPHERINGER_ARENA_HUGE_PAGES 0
+#endif
+
+//==============================================================================
+/**
+    A freshly allocated sample buffer is only backed by memory once it is
+    written to, and the kernel may page it out again later: either way, the
+    first note that reads it takes page faults on the audio thread.
+
+    The arena reserves address space for all instances once, hands it out in
+    whole pages, and locks every block with mlock before the samples are copied
+    in, so they are faulted in and stay in RAM for as long as the zone is
+    resident. Blocks are unlocked and given back to the system on eviction.
+
+    Locking is best effort. Once the lock limit is hit, blocks are still
+    allocated and prefaulted, just not locked, until a locked block is freed.
+    If the arena is full or not available, the buffer simply keeps its own
+    heap allocation.
+
+    Get at it through getShared(): every allocation keeps the arena alive, so
+    zones that outlive their instance can still give their block back.
+*/
+class SampleArena  : public std::enable_shared_from_this<SampleArena>
+{
+public:
+    //==============================================================================
+    // Address space only, nothing is committed until it is used
+    static constexpr size_t reservedBytes = (size_t) 1 << 32;
+
+    ~SampleArena();
+
+    static std::shared_ptr<SampleArena> getShared();
+
+    //==============================================================================
+    /** One block of the arena, given back when this is destroyed. */
+    class Allocation
+    {
+    public:
+        Allocation() = default;
+        Allocation (Allocation&&) noexcept;
+        Allocation& operator= (Allocation&&) noexcept;
+        ~Allocation();
+
+        bool isValid() const noexcept  { return arena != nullptr; }
+        bool isLocked() const noexcept { return locked; }
+
+    private:
+        friend class SampleArena;
+
+        std::shared_ptr<SampleArena> arena;
+        size_t offset = 0, size = 0;
+        bool locked = false;
+
+        void release() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (Allocation)
+    };
+
+    /** Loader threads. Copies the frames into a new block and points the buffer at it.
+        Returns an invalid allocation, and leaves the buffer alone, if there is no room.
+    */
+    Allocation moveIntoArena (QuadFrameBuffer& frames);
+
+    // Bytes currently locked in RAM, for all instances
+    juce::int64 getLockedBytes() const noexcept { return lockedBytes.load(); }
+
+    // True while blocks are going unlocked because the lock limit was hit
+    bool isLockLimitReached() const noexcept { return lockLimitReached.load(); }
+
+private:
+    //==============================================================================
+    SampleArena();
+
+    void free (size_t offset, size_t size, bool wasLocked) noexcept;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+    char* base = nullptr; // start of the usable part, which may be aligned further into the mapping
+    size_t capacity = 0, pageSize = 4096;
+
+    juce::CriticalSection lock;
+    std::map<size_t, size_t> freeBlocks; // offset -> size, never adjacent
+
+    std::atomic<juce::int64> lockedBytes {0};
+    std::atomic<bool> lockLimitReached {false};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleArena)
+};
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    SamplePreprocessor.cpp
+
+  ==============================================================================
+*/
+
+#include "SamplePreprocessor.h"
+
+namespace
+{
+    // Samples are scanned in blocks with the vectorised min/max first, then sample by sample in the block that matters
+    constexpr int scanBlockSize = 64;
+
+    // First sample above the threshold in any channel, or numSamples
+    int findFirstAbove (const juce::AudioSampleBuffer& buffer, const std::vector<float>& dc, float threshold)
+    {
+        const int numSamples = buffer.getNumSamples();
+        int first = numSamples;
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            const float* samples = buffer.getReadPointer (channel);
+            const float offset = dc[(size_t) channel];
+
+            for (int block = 0; block < first; block += scanBlockSize)
+            {
+                const int blockLength = juce::jmin (scanBlockSize, first - block);
+                const auto range = juce::FloatVectorOperations::findMinAndMax (samples + block, blockLength);
+
+                if (range.getEnd() - offset <= threshold && offset - range.getStart() <= threshold)
+                    continue;
+
+                for (int i = block; i < block + blockLength; ++i)
+                {
+                    if (std::abs (samples[i] - offset) > threshold)
+                    {
+                        first = i;
+                        break;
+                    }
+                }
+
+                break;
+            }
+        }
+
+        return first;
+    }
+
+    // One past the last sample above the threshold in any channel, or 0
+    int findLastAbove (const juce::AudioSampleBuffer& buffer, const std::vector<float>& dc, float threshold)
+    {
+        int last = 0;
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            const float* samples = buffer.getReadPointer (channel);
+            const float offset = dc[(size_t) channel];
+
+            for (int blockEnd = buffer.getNumSamples(); blockEnd > last; blockEnd -= scanBlockSize)
+            {
+                const int blockStart = juce::jmax (last, blockEnd - scanBlockSize);
+                const auto range = juce::FloatVectorOperations::findMinAndMax (samples + blockStart, blockEnd - blockStart);
+
+                if (range.getEnd() - offset <= threshold && offset - range.getStart() <= threshold)
+                    continue;
+
+                for (int i = blockEnd; --i >= blockStart;)
+                {
+                    if (std::abs (samples[i] - offset) > threshold)
+                    {
+                        last = i + 1;
+                        break;
+                    }
+                }
+
+                break;
+            }
+        }
+
+        return last;
+    }
+}
+
+//==============================================================================
+SampleTrim SamplePreprocessor::analyse (const juce::AudioSampleBuffer& source, double sampleRate, int mustKeepUpTo)
+{
+    const int numChannels = source.getNumChannels();
+    const int numSamples = source.getNumSamples();
+
+    SampleTrim trim;
+    trim.sourceLength = numSamples;
+    trim.length = numSamples;
+    trim.dcOffsets.assign ((size_t) numChannels, 0.0f);
+
+    if (numSamples == 0)
+        return trim;
+
+    // DC offset: plain mean, four accumulators so the compiler can vectorise it
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* samples = source.getReadPointer (channel);
+        double sums[4] = {};
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+            for (int lane = 0; lane < 4; ++lane)
+                sums[lane] += samples[i + lane];
+
+        for (; i < numSamples; ++i)
+            sums[0] += samples[i];
+
+        trim.dcOffsets[(size_t) channel] = (float) ((sums[0] + sums[1] + sums[2] + sums[3]) / numSamples);
+    }
+
+    const float threshold = juce::Decibels::decibelsToGain (silenceThresholdDb);
+    const int onset = findFirstAbove (source, trim.dcOffsets, threshold);
+
+    // Silent file: leave it alone rather than trimming it away completely
+    if (onset >= numSamples)
+        return trim;
+
+    const int preRoll = juce::roundToInt (preRollSeconds * sampleRate);
+    const int tail = juce::roundToInt (tailSeconds * sampleRate);
+
+    trim.start = juce::jmax (0, onset - preRoll);
+    trim.fadeInLength = onset - trim.start;
+
+    const int decayEnd = findLastAbove (source, trim.dcOffsets, threshold);
+    const int end = juce::jlimit (trim.start + 1, numSamples, juce::jmax (decayEnd + tail, mustKeepUpTo));
+
+    trim.length = end - trim.start;
+
+    // Fade over whatever is left after the decay, unless the protected region runs right to the end
+    trim.fadeOutLength = end > mustKeepUpTo ? juce::jmin (end - juce::jmax (decayEnd, mustKeepUpTo), trim.length) : 0;
+
+    return trim;
+}
+
+juce::AudioSampleBuffer SamplePreprocessor::apply (const juce::AudioSampleBuffer& source, const SampleTrim& trim)
+{
+    juce::AudioSampleBuffer trimmed (source.getNumChannels(), trim.length);
+
+    for (int channel = 0; channel < source.getNumChannels(); ++channel)
+        trimmed.copyFrom (channel, 0, source, channel, trim.start, trim.length);
+
+    applyInPlace (trimmed, trim);
+    return trimmed;
+}
+
+void SamplePreprocessor::applyInPlace (juce::AudioSampleBuffer& trimmedSamples, const SampleTrim& trim)
+{
+    jassert (trimmedSamples.getNumSamples() == trim.length);
+
+    for (int channel = 0; channel < trimmedSamples.getNumChannels() && channel < (int) trim.dcOffsets.size(); ++channel)
+        juce::FloatVectorOperations::add (trimmedSamples.getWritePointer (channel), -trim.dcOffsets[(size_t) channel], trim.length);
+
+    if (trim.fadeInLength > 0)
+        trimmedSamples.applyGainRamp (0, trim.fadeInLength, 0.0f, 1.0f);
+
+    if (trim.fadeOutLength > 0)
+        trimmedSamples.applyGainRamp (trim.length - trim.fadeOutLength, trim.fadeOutLength, 1.0f, 0.0f);
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    SamplePreprocessor.h
+    Load-time cleanup of recordings: DC removal and silence trimming.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/** The part of a source file that is kept, and how to clean it up.
+    Stored with the zone (and in the thumbnail cache), so an evicted zone can
+    be read back from disk and come out exactly the same.
+*/
+struct SampleTrim
+{
+    int sourceLength = 0;   // length of the whole file
+    int start = 0;          // first sample kept
+    int length = 0;         // number of samples kept
+
+    int fadeInLength = 0;   // over the pre-roll before the onset
+    int fadeOutLength = 0;  // over the decay tail, 0 when the zone loops
+    std::vector<float> dcOffsets; // per channel
+
+    bool isTrimmed() const noexcept { return start > 0 || length < sourceLength; }
+};
+
+//==============================================================================
+/**
+    Every trimmed sample has its onset exactly `preRollSeconds` after its first
+    sample, so all zones (and the dynamic layers of a note) speak with the same
+    latency after a note-on.
+*/
+namespace SamplePreprocessor
+{
+    // Anything quieter than this before the onset or after the decay is treated as silence
+    constexpr float silenceThresholdDb = -60.0f;
+
+    constexpr double preRollSeconds = 0.001;
+    constexpr double tailSeconds = 0.02;
+
+    /** Measures DC offset, onset and end of decay. `mustKeepUpTo` protects a
+        region that has to survive the trim, e.g. a loop from the smpl chunk.
+    */
+    SampleTrim analyse (const juce::AudioSampleBuffer& source, double sampleRate, int mustKeepUpTo = 0);
+
+    /** Returns a new buffer holding the trimmed and cleaned part of `source`. */
+    juce::AudioSampleBuffer apply (const juce::AudioSampleBuffer& source, const SampleTrim& trim);
+
+    /** Cleans samples that were read straight from the trimmed region of the
+        file, i.e. the same result as apply() on the whole file.
+    */
+    void applyInPlace (juce::AudioSampleBuffer& trimmedSamples, const SampleTrim& trim);
+}
@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    SampleZone.cpp
+    Loop point detection and crossfade baking, run once when a library loads.
+
+  ==============================================================================
+*/
+
+#include "SampleZone.h"
+
+namespace
+{
+    // Loops shorter than this sound like a buzz rather than a held note
+    constexpr double minLoopSeconds = 0.25;
+
+    // Length of the stretches compared just before the loop start and the loop end
+    constexpr double matchWindowSeconds = 0.02;
+
+    // Hop size of the RMS envelope used to find the sustained part of the note
+    constexpr double envelopeHopSeconds = 0.01;
+
+    // Loop start candidates are scanned at this step first, then refined sample by sample
+    constexpr int coarseStep = 16;
+
+    // Anything below this normalised correlation would produce an audible bump
+    constexpr double minCorrelation = 0.8;
+}
+
+//==============================================================================
+int DynamicLayer::fromFileName (const juce::String& fileNameWithoutExtension)
+{
+    juce::StringArray words;
+    words.addTokens (fileNameWithoutExtension.toLowerCase(), "_- .", "");
+
+    for (const auto& word : words)
+    {
+        if (word == "p" || word == "piano")       return piano;
+        if (word == "mf" || word == "mezzoforte") return mezzoforte;
+        if (word == "f" || word == "forte")       return forte;
+    }
+
+    return mezzoforte;
+}
+
+//==============================================================================
+LoopRegion LoopFinder::fromMetadata (const juce::StringPairArray& metadata, int numSamples)
+{
+    if (metadata.getValue ("NumSampleLoops", "0").getIntValue() <= 0)
+        return {};
+
+    LoopRegion loop;
+    loop.start = metadata.getValue ("Loop0Start", "0").getIntValue();
+    loop.end = metadata.getValue ("Loop0End", "0").getIntValue() + 1; // the smpl chunk stores an inclusive end
+
+    if (loop.start < 0 || loop.end > numSamples || ! loop.isValid())
+        return {};
+
+    return loop;
+}
+
+LoopRegion LoopFinder::findByAutocorrelation (const juce::AudioSampleBuffer& buffer, double sampleRate)
+{
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+    const int window = juce::jmax (1, juce::roundToInt (matchWindowSeconds * sampleRate));
+    const int hop = juce::jmax (1, juce::roundToInt (envelopeHopSeconds * sampleRate));
+    const int minLoopLength = juce::roundToInt (minLoopSeconds * sampleRate);
+
+    if (numChannels == 0 || numSamples < minLoopLength + 4 * window)
+        return {};
+
+    // Mono mixdown, all channels share the same loop points
+    std::vector<float> mono ((size_t) numSamples, 0.0f);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        juce::FloatVectorOperations::add (mono.data(), buffer.getReadPointer (channel), numSamples);
+
+    // The sustained part is where the RMS envelope stays within 6 dB of its peak
+    const int numHops = numSamples / hop;
+    std::vector<float> envelope ((size_t) numHops);
+    float peak = 0.0f;
+
+    for (int i = 0; i < numHops; ++i)
+    {
+        const float* x = mono.data() + i * hop;
+        double sum = 0.0;
+
+        for (int n = 0; n < hop; ++n)
+            sum += (double) x[n] * x[n];
+
+        envelope[(size_t) i] = (float) std::sqrt (sum / hop);
+        peak = juce::jmax (peak, envelope[(size_t) i]);
+    }
+
+    if (peak <= 0.0f)
+        return {};
+
+    const auto isLoud = [threshold = peak * 0.5f] (float level) { return level >= threshold; };
+    const int firstLoudHop = (int) std::distance (envelope.begin(), std::find_if (envelope.begin(), envelope.end(), isLoud));
+    const int lastLoudHop = numHops - 1 - (int) std::distance (envelope.rbegin(), std::find_if (envelope.rbegin(), envelope.rend(), isLoud));
+
+    // Keep the search well clear of the attack so the loop never catches the onset
+    const int loopEnd = lastLoudHop * hop;
+    const int searchFrom = (firstLoudHop + 1) * hop + 2 * window;
+    const int searchTo = loopEnd - minLoopLength;
+
+    if (searchTo <= searchFrom)
+        return {};
+
+    // Running energy so every candidate window is normalised in O(1)
+    std::vector<double> energy ((size_t) numSamples + 1, 0.0);
+
+    for (int n = 0; n < numSamples; ++n)
+        energy[(size_t) n + 1] = energy[(size_t) n] + (double) mono[(size_t) n] * mono[(size_t) n];
+
+    const auto windowEnergy = [&energy, window] (int endSample) { return energy[(size_t) endSample] - energy[(size_t) (endSample - window)]; };
+
+    const float* reference = mono.data() + loopEnd - window;
+    const double referenceEnergy = windowEnergy (loopEnd);
+
+    if (referenceEnergy <= 0.0)
+        return {};
+
+    // How well the material leading into `candidate` matches the material leading into the loop end
+    const auto correlationAt = [&] (int candidate)
+    {
+        const float* x = mono.data() + candidate - window;
+        double dot = 0.0;
+
+        for (int n = 0; n < window; ++n)
+            dot += (double) x[n] * reference[n];
+
+        const double candidateEnergy = windowEnergy (candidate);
+        return candidateEnergy > 0.0 ? dot / std::sqrt (candidateEnergy * referenceEnergy) : 0.0;
+    };
+
+    int bestStart = searchFrom;
+    double bestCorrelation = -1.0;
+
+    const auto tryCandidate = [&] (int candidate)
+    {
+        const double correlation = correlationAt (candidate);
+
+        if (correlation > bestCorrelation)
+        {
+            bestCorrelation = correlation;
+            bestStart = candidate;
+        }
+    };
+
+    for (int candidate = searchFrom; candidate <= searchTo; candidate += coarseStep)
+        tryCandidate (candidate);
+
+    const int coarseBest = bestStart;
+
+    for (int candidate = juce::jmax (searchFrom, coarseBest - coarseStep); candidate <= juce::jmin (searchTo, coarseBest + coarseStep); ++candidate)
+        tryCandidate (candidate);
+
+    if (bestCorrelation < minCorrelation)
+        return {};
+
+    return { bestStart, loopEnd };
+}
+
+void LoopFinder::bakeCrossfade (juce::AudioSampleBuffer& buffer, LoopRegion& loop, int crossfadeLength)
+{
+    jassert (loop.isValid() && loop.end <= buffer.getNumSamples());
+
+    // The fade-in material is taken from just before the loop start, so both
+    // halves of the crossfade have to fit inside the file and inside the loop
+    const int length = juce::jmax (0, juce::jmin (crossfadeLength, loop.start, loop.getLength() / 2));
+
+    for (int channel = 0; channel < buffer.getNumChannels() && length > 0; ++channel)
+    {
+        auto* fadeOut = buffer.getWritePointer (channel, loop.end - length);
+        const auto* fadeIn = buffer.getReadPointer (channel, loop.start - length);
+
+        for (int i = 0; i < length; ++i)
+        {
+            const auto phase = (float) (i + 1) / (float) (length + 1) * juce::MathConstants<float>::halfPi;
+            fadeOut[i] = fadeOut[i] * std::cos (phase) + fadeIn[i] * std::sin (phase);
+        }
+    }
+
+    // Nothing after the loop end is ever played, so give the memory back
+    buffer.setSize (buffer.getNumChannels(), loop.end, true);
+}
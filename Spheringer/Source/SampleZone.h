@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    SampleZone.h
+    Pre-loaded sample data for one MIDI number, plus its sustain loop.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleArena.h"
+#include "SamplePreprocessor.h"
+
+//==============================================================================
+/** Sustain loop inside a zone's sample data, in samples. `end` is exclusive. */
+struct LoopRegion
+{
+    int start = 0;
+    int end = 0;
+
+    bool isValid() const noexcept  { return end > start; }
+    int getLength() const noexcept { return end - start; }
+};
+
+//==============================================================================
+/** Dynamic layers a note can be recorded in, softest first. */
+namespace DynamicLayer
+{
+    enum
+    {
+        piano,
+        mezzoforte,
+        forte,
+        numLayers
+    };
+
+    /** The layer named anywhere in the file name, as a word of its own, e.g.
+        Choir_forte_C4_60.wav or Choir_f_C4_60.wav. Files that don't name one
+        are mezzoforte.
+    */
+    int fromFileName (const juce::String& fileNameWithoutExtension);
+}
+
+//==============================================================================
+/** One sample mapped to a MIDI number and dynamic layer.
+    Reference counted so a voice can keep playing a zone after a newer
+    version of it has been published, and so instances loading the same
+    file can share it.
+
+    The sample data is only in memory while the zone is resident; the loader
+    thread loads and evicts it to stay inside the memory budget. The audio
+    thread pins a zone before looking at `resident`, and the loader clears
+    `resident` before looking at the pins, so whichever comes second backs off:
+    a pinned zone is never evicted, and an evicted zone is never played.
+*/
+struct SampleZone  : public juce::ReferenceCountedObject
+{
+    using Ptr = juce::ReferenceCountedObjectPtr<SampleZone>;
+
+    // Audio thread. Returns true if the samples can be played straight away.
+    bool pin() noexcept             { pins.fetch_add (1); return resident.load(); }
+    void unpin() noexcept           { pins.fetch_sub (1); }
+    bool isResident() const noexcept { return resident.load(); }
+
+    // Size of the sample data once loaded: always four lanes per frame
+    juce::int64 getSizeInBytes() const noexcept { return (juce::int64) QuadFrameBuffer::numChannels * numSamples * (juce::int64) sizeof (float); }
+
+    QuadFrameBuffer frames; // interleaved L, R, Ls, Rs, only valid while resident
+    SampleArena::Allocation storage; // what the frames refer to, unless the arena had no room and they have their own
+    double sampleRate = 44100.0;
+    int rootNote = 0;
+    float tuningCents = 0.0f; // how far the recording is from rootNote, corrected on playback
+    int layer = DynamicLayer::mezzoforte;
+    int numChannels = 0, numSamples = 0; // source channels in the frames (lanes past them repeat the last one), and frames
+
+    juce::File sourceFile;
+    SampleTrim trim; // which part of sourceFile the frames hold, and how it was cleaned up
+
+    std::atomic<int> pins {0};
+    std::atomic<bool> resident {false};
+    std::atomic<juce::uint32> lastUsed {0}; // LRU clock shared by the loader threads of all instances
+
+    // Loader threads only: the zone may be shared by several instances, and only one of them loads or evicts it at a time
+    juce::CriticalSection residencyLock;
+    bool isShared = false; // held by the SharedZoneCache as well, set before the zone is first published
+
+    // When valid, the crossfade is already baked into the samples just before
+    // loop.end and the frames have been cut at loop.end, so playback only needs
+    // to jump back to loop.start.
+    LoopRegion loop;
+};
+
+//==============================================================================
+/** The zones the audio thread plays from. Never modified once published:
+    a change to the library is published as a new SampleLibrary.
+*/
+struct SampleLibrary  : public juce::ReferenceCountedObject
+{
+    using Ptr = juce::ReferenceCountedObjectPtr<SampleLibrary>;
+
+    // Every layer of one note, indexed by DynamicLayer. Layers that weren't recorded are null.
+    using Layers = std::array<SampleZone::Ptr, DynamicLayer::numLayers>;
+
+    const Layers* getLayers (int noteNumber) const
+    {
+        const auto iterator = zones.find (noteNumber);
+        return iterator != zones.end() ? &iterator->second : nullptr;
+    }
+
+    SampleZone::Ptr getZone (int noteNumber, int layer) const
+    {
+        const auto* layers = getLayers (noteNumber);
+        return layers != nullptr ? (*layers)[(size_t) layer] : nullptr;
+    }
+
+    std::map<int, Layers> zones;
+};
+
+//==============================================================================
+/** Offline helpers for finding and preparing sustain loops at load time. */
+namespace LoopFinder
+{
+    /** Reads the first sampler loop from a WAV `smpl` chunk, as exposed by
+        juce::WavAudioFormat in AudioFormatReader::metadataValues.
+        Returns an invalid region if the file has no usable loop.
+    */
+    LoopRegion fromMetadata (const juce::StringPairArray& metadata, int numSamples);
+
+    /** Searches the sustained part of the sample for a loop whose start and end
+        match best, using normalised autocorrelation of a mono mixdown.
+        Returns an invalid region if no convincing loop was found.
+    */
+    LoopRegion findByAutocorrelation (const juce::AudioSampleBuffer& buffer, double sampleRate);
+
+    /** Bakes an equal-power crossfade into the samples leading up to loop.end,
+        then trims everything after loop.end, which is never played once the
+        voice is looping.
+    */
+    void bakeCrossfade (juce::AudioSampleBuffer& buffer, LoopRegion& loop, int crossfadeLength);
+}
@@ -0,0 +1,391 @@
+/*
+  ==============================================================================
+
+    SamplerVoice.cpp
+
+  ==============================================================================
+*/
+
+#include "SamplerVoice.h"
+#include "SimdFloat4.h"
+
+namespace
+{
+    // a += (b - a) * g, with g going linearly from `from` towards `to` over the block, one whole frame at a time
+    void crossfade (QuadFrameBuffer& a, const QuadFrameBuffer& b, int numFrames, float from, float to) noexcept
+    {
+        const auto step = SimdFloat4::broadcast ((to - from) / (float) numFrames);
+        auto gain = SimdFloat4::broadcast (from);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const auto x = SimdFloat4::load (a.getFrame (i));
+            x.multiplyAdd (SimdFloat4::load (b.getFrame (i)) - x, gain).store (a.getFrame (i));
+            gain = gain + step;
+        }
+    }
+
+    // Multiplies every frame by a gain going linearly from `from` to `to`, like AudioBuffer::applyGainRamp
+    void applyGainRamp (QuadFrameBuffer& frames, int numFrames, float from, float to) noexcept
+    {
+        const auto step = SimdFloat4::broadcast ((to - from) / (float) numFrames);
+        auto gain = SimdFloat4::broadcast (from);
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            (SimdFloat4::load (frames.getFrame (i)) * gain).store (frames.getFrame (i));
+            gain = gain + step;
+        }
+    }
+
+    const float silentFrame[QuadFrameBuffer::numChannels] = {};
+}
+
+//==============================================================================
+void SamplerVoice::prepare (double sampleRate, int maximumBlockSize, int numChannels)
+{
+    envelope.setSampleRate (sampleRate);
+    outputSampleRate = sampleRate;
+    maxWaitSamples = juce::roundToInt (maxWaitSeconds * sampleRate);
+    maxSourceChannels = juce::jmin (numChannels, QuadFrameBuffer::numChannels);
+    voiceBuffer.setSize (maximumBlockSize);
+    layerBuffer.setSize (maximumBlockSize);
+    kill();
+}
+
+void SamplerVoice::setEnvelopeParameters (const juce::ADSR::Parameters& params)
+{
+    envelope.setParameters (params);
+}
+
+void SamplerVoice::startNote (int midiNoteNumber, const SampleLibrary::Layers& zonesToPlay, juce::uint32 order,
+                              float noteAzimuth, const SpatialPosition& shared, float dynamicsToUse)
+{
+    kill();
+
+    // Every layer starts at the top of its sample. The trim puts the same pre-roll in front
+    // of every onset, so the layers line up with each other.
+    bool allResident = true;
+
+    for (const auto& zone : zonesToPlay)
+    {
+        if (zone == nullptr)
+            continue;
+
+        auto& layer = layers[(size_t) numLayers++];
+        layer.zone = zone;
+        layer.playbackRatio = zone->sampleRate / outputSampleRate * std::exp2 (-zone->tuningCents / 1200.0);
+        allResident = zone->pin() && allResident;
+    }
+
+    if (numLayers == 0)
+        return;
+
+    // All layers are pinned, so the controller can bring any of them in later
+    waitingForSamples = ! allResident;
+    samplesWaited = 0;
+    noteNumber = midiNoteNumber;
+    noteOnOrder = order;
+    numChannels = juce::jmin (layers[0].zone->numChannels, maxSourceChannels);
+    dynamics = dynamicsToUse;
+    layerPosition = dynamics * (float) (numLayers - 1);
+    releasing = false;
+    level = 1.0f; // not rendered yet, so don't look like an easy target for stealing
+    stealLength = stealSamplesLeft = 0;
+
+    azimuthOffset = noteAzimuth;
+    spatialiser.reset ({ azimuthOffset + shared.azimuth, shared.elevation, shared.width }, numChannels);
+
+    envelope.reset();
+    envelope.noteOn();
+}
+
+void SamplerVoice::setSharedSpatialPosition (const SpatialPosition& shared) noexcept
+{
+    spatialiser.setTarget ({ azimuthOffset + shared.azimuth, shared.elevation, shared.width });
+}
+
+void SamplerVoice::stopNote()
+{
+    releasing = true;
+    envelope.noteOff();
+}
+
+void SamplerVoice::steal (int fadeLengthSamples)
+{
+    if (! isActive() || isBeingStolen())
+        return;
+
+    // Nothing to fade yet
+    if (waitingForSamples)
+    {
+        kill();
+        return;
+    }
+
+    stealLength = stealSamplesLeft = juce::jmax (1, fadeLengthSamples);
+}
+
+void SamplerVoice::kill()
+{
+    for (int i = 0; i < numLayers; ++i)
+    {
+        layers[(size_t) i].zone->unpin();
+        layers[(size_t) i] = {};
+    }
+
+    numLayers = 0;
+    waitingForSamples = false;
+    noteNumber = -1;
+    releasing = false;
+    level = 0.0f;
+    stealLength = stealSamplesLeft = 0;
+    envelope.reset();
+}
+
+//==============================================================================
+void SamplerVoice::renderNextBlock (MixBus& outputBuffer, int startSample, int numSamples)
+{
+    if (waitingForSamples)
+    {
+        // Offline the processor has loaded the zones on note-on already, so only a missing file ends up here
+        if (! areAllLayersResident())
+        {
+            samplesWaited += numSamples;
+
+            if (samplesWaited >= maxWaitSamples)
+                kill();
+
+            return;
+        }
+
+        // Arrived: the note starts here, from the top of the sample
+        waitingForSamples = false;
+    }
+
+    // Hosts may hand us bigger blocks than announced in prepareToPlay
+    while (numSamples > 0 && isActive())
+    {
+        const int chunk = juce::jmin (numSamples, voiceBuffer.getNumFrames());
+        renderChunk (outputBuffer, startSample, chunk);
+
+        startSample += chunk;
+        numSamples -= chunk;
+    }
+}
+
+bool SamplerVoice::areAllLayersResident() const noexcept
+{
+    for (int i = 0; i < numLayers; ++i)
+        if (! layers[(size_t) i].zone->isResident())
+            return false;
+
+    return true;
+}
+
+void SamplerVoice::renderChunk (MixBus& outputBuffer, int startSample, int numSamples)
+{
+    // Head for the controller, but stop at the next layer: that one's pair takes over in the next chunk
+    const float target = dynamics * (float) (numLayers - 1);
+    int lower = (int) layerPosition;
+
+    if (target < layerPosition && (float) lower == layerPosition)
+        --lower; // sitting on a layer and heading down: pair it with the one below
+
+    lower = juce::jlimit (0, juce::jmax (0, numLayers - 2), lower);
+
+    const int upper = juce::jmin (lower + 1, numLayers - 1);
+    const float from = layerPosition - (float) lower;
+    const float to = juce::jlimit (0.0f, 1.0f, target - (float) lower);
+    layerPosition = (float) lower + to;
+
+    // Weight of the upper layer. Only the layers that can be heard are read.
+    const bool readLower = upper == lower || from < 1.0f || to < 1.0f;
+    const bool readUpper = upper != lower && (from > 0.0f || to > 0.0f);
+    int rendered = 0;
+
+    if (readLower && readUpper)
+    {
+        rendered = juce::jmax (readLayer (layers[(size_t) lower], voiceBuffer, numSamples),
+                               readLayer (layers[(size_t) upper], layerBuffer, numSamples));
+
+        crossfade (voiceBuffer, layerBuffer, numSamples, from, to);
+    }
+    else
+    {
+        rendered = readLayer (layers[(size_t) (readLower ? lower : upper)], voiceBuffer, numSamples);
+    }
+
+    // Everything else keeps time for when the controller brings it in
+    for (int i = 0; i < numLayers; ++i)
+        if (! ((i == lower && readLower) || (i == upper && readUpper)))
+            skipLayer (layers[(size_t) i], numSamples);
+
+    // Unlooped sample played to its end
+    const bool reachedEnd = rendered < numSamples;
+
+    for (int i = 0; i < numSamples; ++i)
+        (SimdFloat4::load (voiceBuffer.getFrame (i)) * SimdFloat4::broadcast (envelope.getNextSample())).store (voiceBuffer.getFrame (i));
+
+    // Stolen: fade out over the steal length, whatever stage the envelope is in
+    bool stealFinished = false;
+
+    if (isBeingStolen())
+    {
+        const int fade = juce::jmin (numSamples, stealSamplesLeft);
+        const auto startGain = (float) stealSamplesLeft / (float) stealLength;
+        stealSamplesLeft -= fade;
+        const auto endGain = (float) stealSamplesLeft / (float) stealLength;
+
+        applyGainRamp (voiceBuffer, fade, startGain, endGain);
+
+        if (fade < numSamples)
+            voiceBuffer.clear (fade, numSamples - fade);
+
+        stealFinished = stealSamplesLeft == 0;
+    }
+
+    // Lanes past numChannels repeat the last channel, so they can't raise the peak
+    auto peak = SimdFloat4::broadcast (0.0f);
+
+    for (int i = 0; i < numSamples; ++i)
+        peak = peak.max (SimdFloat4::load (voiceBuffer.getFrame (i)).abs());
+
+    level = peak.horizontalMax();
+
+    // Into the quad image at this voice's position
+    spatialiser.process (voiceBuffer, 0, outputBuffer, startSample, numSamples);
+
+    if (reachedEnd || stealFinished || ! envelope.isActive())
+        kill();
+}
+
+int SamplerVoice::readLayer (Layer& layer, QuadFrameBuffer& destination, int numSamples)
+{
+    int rendered = 0;
+
+    if (! layer.finished)
+        rendered = layer.playbackRatio == 1.0 ? readSamples (layer, destination, numSamples)
+                                              : readInterpolated (layer, destination, numSamples);
+
+    if (rendered < numSamples)
+    {
+        layer.finished = true;
+        destination.clear (rendered, numSamples - rendered);
+    }
+
+    return rendered;
+}
+
+int SamplerVoice::readSamples (Layer& layer, QuadFrameBuffer& destination, int numSamples)
+{
+    const auto& zone = *layer.zone;
+    const auto& source = zone.frames;
+    const bool isLooping = zone.loop.isValid();
+    const int end = isLooping ? zone.loop.end : source.getNumFrames();
+    auto& position = layer.position;
+
+    // Copy whole runs of frames up to the loop end, then wrap: no per-sample bounds checks
+    int rendered = 0;
+
+    while (rendered < numSamples)
+    {
+        const int run = juce::jmin (numSamples - rendered, end - position);
+
+        juce::FloatVectorOperations::copy (destination.getFrame (rendered), source.getFrame (position), run * QuadFrameBuffer::numChannels);
+
+        rendered += run;
+        position += run;
+
+        if (position < end)
+            continue;
+
+        if (! isLooping)
+            break;
+
+        position = zone.loop.start;
+    }
+
+    return rendered;
+}
+
+int SamplerVoice::readInterpolated (Layer& layer, QuadFrameBuffer& destination, int numSamples)
+{
+    const auto& zone = *layer.zone;
+    const auto& source = zone.frames;
+    const bool isLooping = zone.loop.isValid();
+    const int end = isLooping ? zone.loop.end : source.getNumFrames();
+    const int loopLength = zone.loop.getLength();
+    const bool useHermite = quality == RenderQuality::offline;
+    auto& position = layer.position;
+    auto& fraction = layer.fraction;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (! isLooping && position >= end)
+            return i;
+
+        // The four frames around the playhead, one load each. Past the loop end reading carries on
+        // from the loop start; before the start or past the end of an unlooped sample it is silence.
+        const auto at = [&] (int k)
+        {
+            int index = position - 1 + k;
+
+            if (isLooping)
+                while (index >= end)
+                    index -= loopLength;
+
+            return SimdFloat4::load (index >= 0 && index < end ? source.getFrame (index) : silentFrame);
+        };
+
+        const auto t = SimdFloat4::broadcast ((float) fraction);
+
+        if (useHermite)
+        {
+            const auto xm1 = at (0), x0 = at (1), x1 = at (2), x2 = at (3);
+            const auto half = SimdFloat4::broadcast (0.5f);
+            const auto c1 = half * (x1 - xm1);
+            const auto c2 = xm1 - SimdFloat4::broadcast (2.5f) * x0 + SimdFloat4::broadcast (2.0f) * x1 - half * x2;
+            const auto c3 = (half * (x2 - xm1)).multiplyAdd (SimdFloat4::broadcast (1.5f), x0 - x1);
+            (((c3 * t + c2) * t + c1) * t + x0).store (destination.getFrame (i));
+        }
+        else
+        {
+            const auto x0 = at (1);
+            x0.multiplyAdd (t, at (2) - x0).store (destination.getFrame (i));
+        }
+
+        fraction += layer.playbackRatio;
+        const auto step = (int) fraction;
+        fraction -= step;
+        position += step;
+
+        if (isLooping)
+            while (position >= end)
+                position -= loopLength;
+    }
+
+    return numSamples;
+}
+
+void SamplerVoice::skipLayer (Layer& layer, int numSamples) noexcept
+{
+    if (layer.finished)
+        return;
+
+    const auto& zone = *layer.zone;
+    const int end = zone.loop.isValid() ? zone.loop.end : zone.frames.getNumFrames();
+
+    const double advanced = layer.fraction + layer.playbackRatio * numSamples;
+    const auto step = (int) advanced;
+    layer.fraction = advanced - step;
+    layer.position += step;
+
+    if (layer.position < end)
+        return;
+
+    if (zone.loop.isValid())
+        layer.position = zone.loop.start + (layer.position - zone.loop.start) % zone.loop.getLength();
+    else
+        layer.finished = true;
+}
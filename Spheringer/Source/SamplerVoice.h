@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    SamplerVoice.h
+    Plays one SampleZone, looping its sustain region until released.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleZone.h"
+#include "VoiceSpatialiser.h"
+
+//==============================================================================
+/** Live playback has a deadline; offline bounces can take as long as they like. */
+enum class RenderQuality
+{
+    realtime,
+    offline
+};
+
+//==============================================================================
+/**
+    Reads straight from the zone's pre-loaded quad frames, one load per frame,
+    and nothing is copied on note-on.
+    The voice holds a reference to its zone, so it plays on undisturbed when the
+    library is reloaded underneath it, and pins it so it isn't evicted. If the
+    zone isn't in memory yet, the voice stays silent until it is: a late start
+    sounds better than a missing note. Offline bounces never start late, the
+    processor loads the zones before the voice renders.
+    The loop crossfade is baked in at load time, so wrapping around is just a
+    jump back to loop.start in between two block copies.
+    Zones recorded at another sample rate than the host's are resampled while
+    playing: linear interpolation live, 4-point Hermite when rendering offline.
+
+    A note can have several dynamic layers. They all start together, and the
+    dynamics controller crossfades between the two adjacent layers it sits
+    between; the others only move their playheads along, so the voice never
+    reads more than two layers however fast the controller moves.
+*/
+class SamplerVoice
+{
+public:
+    //==============================================================================
+    void prepare (double sampleRate, int maximumBlockSize, int numChannels);
+    void setEnvelopeParameters (const juce::ADSR::Parameters& params);
+    void setRenderQuality (RenderQuality newQuality) noexcept { quality = newQuality; }
+
+    // noteAzimuth is this note's own offset, added to the azimuth shared by all voices.
+    // dynamics goes from 0 (softest layer) to 1 (loudest layer).
+    void startNote (int midiNoteNumber, const SampleLibrary::Layers& zonesToPlay, juce::uint32 noteOnOrder,
+                    float noteAzimuth, const SpatialPosition& shared, float dynamics);
+    void setSharedSpatialPosition (const SpatialPosition& shared) noexcept;
+    void setDynamics (float newDynamics) noexcept { dynamics = newDynamics; }
+    void stopNote();    // enters the release stage
+    void steal (int fadeLengthSamples); // short linear fade, then the voice is free again
+    void kill();        // stops immediately, without any fade
+
+    bool isActive() const noexcept      { return numLayers > 0; }
+    bool isReleasing() const noexcept   { return releasing; }
+    bool isBeingStolen() const noexcept { return stealLength > 0; }
+    bool isWaitingForSamples() const noexcept { return waitingForSamples; }
+    int getNoteNumber() const noexcept  { return noteNumber; }
+
+    // Lower means the note was started earlier
+    juce::uint32 getNoteOnOrder() const noexcept { return noteOnOrder; }
+
+    // Peak of the most recently rendered chunk, after envelope and fades
+    float getLevel() const noexcept { return level; }
+
+    // Adds the voice's output on top of whatever is already in the buffer
+    void renderNextBlock (MixBus& outputBuffer, int startSample, int numSamples);
+
+private:
+    //==============================================================================
+    // One dynamic layer of the note
+    struct Layer
+    {
+        SampleZone::Ptr zone;
+        int position = 0;           // playhead inside zone->frames
+        double fraction = 0.0;      // ...and how far it is towards the next sample
+        double playbackRatio = 1.0; // zone samples per output sample
+        bool finished = false;      // unlooped sample played to its end
+    };
+
+    void renderChunk (MixBus& outputBuffer, int startSample, int numSamples);
+    bool areAllLayersResident() const noexcept;
+
+    // Fill the start of destination from the layer, returning how many samples there were before an unlooped sample ended
+    int readLayer (Layer& layer, QuadFrameBuffer& destination, int numSamples);
+    int readSamples (Layer& layer, QuadFrameBuffer& destination, int numSamples);
+    int readInterpolated (Layer& layer, QuadFrameBuffer& destination, int numSamples);
+
+    // Moves the playhead on without reading anything, so the layer is in step when it comes in
+    void skipLayer (Layer& layer, int numSamples) noexcept;
+
+    std::array<Layer, DynamicLayer::numLayers> layers; // only the first numLayers are used, softest first
+    int numLayers = 0, numChannels = 0, maxSourceChannels = 0;
+    float dynamics = 0.5f;
+    float layerPosition = 0.0f; // the crossfade: 0 is the first layer, 1 the second, and so on
+
+    int noteNumber = -1;
+    double outputSampleRate = 44100.0;
+    RenderQuality quality = RenderQuality::realtime;
+    juce::uint32 noteOnOrder = 0;
+    bool releasing = false;
+    float level = 0.0f;
+
+    // Zone not resident yet. Given up after maxWaitSeconds, e.g. if the file went missing.
+    bool waitingForSamples = false;
+    int samplesWaited = 0, maxWaitSamples = 0;
+    static constexpr double maxWaitSeconds = 1.0;
+
+    int stealLength = 0, stealSamplesLeft = 0;
+
+    juce::ADSR envelope;
+    QuadFrameBuffer voiceBuffer; // scratch space so the envelope can be applied before mixing
+    QuadFrameBuffer layerBuffer; // the second layer, while two are crossfaded
+
+    float azimuthOffset = 0.0f;
+    VoiceSpatialiser spatialiser;
+};
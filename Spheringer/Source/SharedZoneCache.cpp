@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    SharedZoneCache.cpp
+
+  ==============================================================================
+*/
+
+#include "SharedZoneCache.h"
+#include "RealtimeGuard.h"
+
+//==============================================================================
+juce::String SharedZoneCache::makeKey (const juce::File& file, const juce::String& contentHash)
+{
+    // Through any symlinks, so two instances pointed at the same library by different routes still share it
+    return file.getLinkedTarget().getFullPathName() + "#" + contentHash;
+}
+
+SampleZone::Ptr SharedZoneCache::acquire (const juce::String& key, Owner owner)
+{
+    RealtimeGuard::check ("SharedZoneCache lock");
+    const juce::ScopedLock sl (lock);
+    const auto iterator = zones.find (key);
+
+    if (iterator == zones.end())
+        return nullptr;
+
+    iterator->second.owners.insert (owner);
+    return iterator->second.zone;
+}
+
+SampleZone::Ptr SharedZoneCache::add (const juce::String& key, SampleZone::Ptr zone, Owner owner)
+{
+    RealtimeGuard::check ("SharedZoneCache lock");
+    jassert (zone != nullptr);
+
+    const juce::ScopedLock sl (lock);
+    auto& shared = zones[key];
+
+    // Two instances decoded the same file at the same time: the second copy is dropped here, on its loader thread
+    if (shared.zone == nullptr)
+    {
+        zone->isShared = true;
+        shared.zone = std::move (zone);
+    }
+
+    shared.owners.insert (owner);
+    return shared.zone;
+}
+
+void SharedZoneCache::release (const SampleZone& zone, Owner owner)
+{
+    RealtimeGuard::check ("SharedZoneCache lock");
+    const juce::ScopedLock sl (lock);
+
+    for (auto& entry : zones)
+    {
+        if (entry.second.zone.get() == &zone)
+        {
+            entry.second.owners.erase (owner);
+            return;
+        }
+    }
+}
+
+void SharedZoneCache::releaseAll (Owner owner)
+{
+    RealtimeGuard::check ("SharedZoneCache lock");
+    const juce::ScopedLock sl (lock);
+
+    for (auto& entry : zones)
+        entry.second.owners.erase (owner);
+}
+
+void SharedZoneCache::releaseUnused()
+{
+    RealtimeGuard::check ("SharedZoneCache lock");
+    std::vector<SampleZone::Ptr> unused;
+
+    {
+        const juce::ScopedLock sl (lock);
+
+        // No instance claims it and no voice still plays it, and none can pick it up again without this lock
+        for (auto entry = zones.begin(); entry != zones.end();)
+        {
+            if (entry->second.owners.empty() && entry->second.zone->getReferenceCount() == 1)
+            {
+                unused.push_back (std::move (entry->second.zone));
+                entry = zones.erase (entry);
+            }
+            else
+            {
+                ++entry;
+            }
+        }
+    }
+
+    // Sample data is freed here, outside the lock
+}
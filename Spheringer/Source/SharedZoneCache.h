@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    SharedZoneCache.h
+    Decoded sample zones shared by every Spheringer instance in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleZone.h"
+
+//==============================================================================
+/**
+    Instances that load the same file get the same SampleZone, so a library
+    loaded by sixteen instances is decoded once and held in memory once.
+
+    Get at it through a juce::SharedResourcePointer: the cache is created by the
+    first instance and deleted with the last one. Zones are keyed by the file's
+    canonical path and content hash, so a file changed on disk is never mixed up
+    with its old version.
+
+    Every instance that gets a zone from the cache holds a claim on it until
+    it gives it back with release(). The cache also holds a reference to every
+    zone in it, so a voice that keeps playing a zone after its instance let go
+    never drops the last reference on the audio thread. A zone leaves the cache
+    once no instance claims it and nothing else references it, which only ever
+    happens on a loader thread.
+*/
+class SharedZoneCache
+{
+public:
+    //==============================================================================
+    SharedZoneCache() = default;
+
+    static juce::String makeKey (const juce::File& file, const juce::String& contentHash);
+
+    // Identifies the instance holding a claim, e.g. its loader
+    using Owner = const void*;
+
+    // Loader threads. The zone another instance already made for this key, if any, claimed for the owner.
+    SampleZone::Ptr acquire (const juce::String& key, Owner owner);
+
+    // Loader threads. Shares the zone, unless another instance got there first:
+    // returns the zone to use from now on, either way, claimed for the owner.
+    SampleZone::Ptr add (const juce::String& key, SampleZone::Ptr zone, Owner owner);
+
+    // Loader threads. The owner no longer uses the zone, or any zone at all.
+    void release (const SampleZone& zone, Owner owner);
+    void releaseAll (Owner owner);
+
+    // Loader threads. Drops zones that no instance claims and nothing else references.
+    void releaseUnused();
+
+    // Loader threads. Ticks of the least-recently-used clock all instances stamp their zones with.
+    juce::uint32 advanceUseClock() noexcept { return ++useClock; }
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        SampleZone::Ptr zone;
+        std::set<Owner> owners;
+    };
+
+    juce::CriticalSection lock;
+    std::map<juce::String, Entry> zones;
+    std::atomic<juce::uint32> useClock {0};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedZoneCache)
+};
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    SimdFloat4.h
+    Four floats in one register: SSE on Intel, NEON on ARM, plain C++ elsewhere.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <immintrin.h>
+ #define SPHERINGER_SIMD_SSE 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #include <arm_neon.h>
+ #define SPHERINGER_SIMD_NEON 1
+#endif
+
+//==============================================================================
+/** Just what the mixing loops need. Loads and stores are unaligned. */
+struct SimdFloat4
+{
+   #if SPHERINGER_SIMD_SSE
+    __m128 v;
+
+    static SimdFloat4 load (const float* p) noexcept                           { return { _mm_loadu_ps (p) }; }
+    static SimdFloat4 broadcast (float x) noexcept                             { return { _mm_set1_ps (x) }; }
+    static SimdFloat4 fromValues (float a, float b, float c, float d) noexcept { return { _mm_setr_ps (a, b, c, d) }; }
+    void store (float* p) const noexcept                                       { _mm_storeu_ps (p, v); }
+
+    SimdFloat4 operator+ (SimdFloat4 other) const noexcept { return { _mm_add_ps (v, other.v) }; }
+    SimdFloat4 operator- (SimdFloat4 other) const noexcept { return { _mm_sub_ps (v, other.v) }; }
+    SimdFloat4 operator* (SimdFloat4 other) const noexcept { return { _mm_mul_ps (v, other.v) }; }
+    SimdFloat4 min (SimdFloat4 other) const noexcept       { return { _mm_min_ps (v, other.v) }; }
+    SimdFloat4 max (SimdFloat4 other) const noexcept       { return { _mm_max_ps (v, other.v) }; }
+    SimdFloat4 abs() const noexcept                        { return { _mm_andnot_ps (_mm_set1_ps (-0.0f), v) }; }
+
+    template <int lane> SimdFloat4 broadcastLane() const noexcept { return { _mm_shuffle_ps (v, v, _MM_SHUFFLE (lane, lane, lane, lane)) }; }
+   #elif SPHERINGER_SIMD_NEON
+    float32x4_t v;
+
+    static SimdFloat4 load (const float* p) noexcept                           { return { vld1q_f32 (p) }; }
+    static SimdFloat4 broadcast (float x) noexcept                             { return { vdupq_n_f32 (x) }; }
+    static SimdFloat4 fromValues (float a, float b, float c, float d) noexcept { const float values[] { a, b, c, d }; return load (values); }
+    void store (float* p) const noexcept                                       { vst1q_f32 (p, v); }
+
+    SimdFloat4 operator+ (SimdFloat4 other) const noexcept { return { vaddq_f32 (v, other.v) }; }
+    SimdFloat4 operator- (SimdFloat4 other) const noexcept { return { vsubq_f32 (v, other.v) }; }
+    SimdFloat4 operator* (SimdFloat4 other) const noexcept { return { vmulq_f32 (v, other.v) }; }
+    SimdFloat4 min (SimdFloat4 other) const noexcept       { return { vminq_f32 (v, other.v) }; }
+    SimdFloat4 max (SimdFloat4 other) const noexcept       { return { vmaxq_f32 (v, other.v) }; }
+    SimdFloat4 abs() const noexcept                        { return { vabsq_f32 (v) }; }
+
+    template <int lane> SimdFloat4 broadcastLane() const noexcept { return { vdupq_n_f32 (vgetq_lane_f32 (v, lane)) }; }
+   #else
+    float v[4];
+
+    static SimdFloat4 load (const float* p) noexcept                           { return { { p[0], p[1], p[2], p[3] } }; }
+    static SimdFloat4 broadcast (float x) noexcept                             { return { { x, x, x, x } }; }
+    static SimdFloat4 fromValues (float a, float b, float c, float d) noexcept { return { { a, b, c, d } }; }
+    void store (float* p) const noexcept                                       { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+
+    SimdFloat4 operator+ (SimdFloat4 other) const noexcept { return { { v[0] + other.v[0], v[1] + other.v[1], v[2] + other.v[2], v[3] + other.v[3] } }; }
+    SimdFloat4 operator- (SimdFloat4 other) const noexcept { return { { v[0] - other.v[0], v[1] - other.v[1], v[2] - other.v[2], v[3] - other.v[3] } }; }
+    SimdFloat4 operator* (SimdFloat4 other) const noexcept { return { { v[0] * other.v[0], v[1] * other.v[1], v[2] * other.v[2], v[3] * other.v[3] } }; }
+    SimdFloat4 min (SimdFloat4 other) const noexcept       { return { { juce::jmin (v[0], other.v[0]), juce::jmin (v[1], other.v[1]), juce::jmin (v[2], other.v[2]), juce::jmin (v[3], other.v[3]) } }; }
+    SimdFloat4 max (SimdFloat4 other) const noexcept       { return { { juce::jmax (v[0], other.v[0]), juce::jmax (v[1], other.v[1]), juce::jmax (v[2], other.v[2]), juce::jmax (v[3], other.v[3]) } }; }
+    SimdFloat4 abs() const noexcept                        { return { { std::abs (v[0]), std::abs (v[1]), std::abs (v[2]), std::abs (v[3]) } }; }
+
+    template <int lane> SimdFloat4 broadcastLane() const noexcept { return broadcast (v[lane]); }
+   #endif
+
+    // this + a * b
+    SimdFloat4 multiplyAdd (SimdFloat4 a, SimdFloat4 b) const noexcept { return *this + a * b; }
+
+    float horizontalMax() const noexcept
+    {
+        float lanes[4];
+        store (lanes);
+        return juce::jmax (lanes[0], lanes[1], lanes[2], lanes[3]);
+    }
+
+    float horizontalSum() const noexcept
+    {
+        float lanes[4];
+        store (lanes);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+};
@@ -0,0 +1,305 @@
+/*
+  ==============================================================================
+
+    ThumbnailCache.cpp
+
+  ==============================================================================
+*/
+
+#include "ThumbnailCache.h"
+#include "RealtimeGuard.h"
+#include "SimdFloat4.h"
+
+namespace
+{
+    constexpr int finestSamplesPerBin = 64;
+    constexpr int levelRatio = 4;
+    constexpr int numLevels = 5; // 64 .. 16384 samples per bin
+
+    constexpr int fileMagic = 0x48545053; // "SPTH"
+    constexpr int maxSourceChannels = 64; // anything above is a corrupt file
+}
+
+//==============================================================================
+std::shared_ptr<WaveformSummary> WaveformSummary::create (const SampleZone& zone)
+{
+    auto summary = std::make_shared<WaveformSummary>();
+    summary->numChannels = zone.numChannels;
+    summary->numSamples = zone.frames.getNumFrames();
+    summary->sampleRate = zone.sampleRate;
+    summary->rootNote = zone.rootNote;
+    summary->tuningCents = zone.tuningCents;
+    summary->loop = zone.loop;
+    summary->trim = zone.trim;
+
+    // The finest level comes straight from the samples...
+    Level finest;
+    finest.samplesPerBin = finestSamplesPerBin;
+    finest.numBins = (summary->numSamples + finestSamplesPerBin - 1) / finestSamplesPerBin;
+    finest.mins.resize ((size_t) (finest.numBins * summary->numChannels));
+    finest.maxs.resize (finest.mins.size());
+
+    // All four lanes of a frame at once
+    for (int bin = 0; bin < finest.numBins; ++bin)
+    {
+        const int start = bin * finestSamplesPerBin;
+        const int end = juce::jmin (start + finestSamplesPerBin, summary->numSamples);
+        auto lowest = SimdFloat4::load (zone.frames.getFrame (start));
+        auto highest = lowest;
+
+        for (int i = start + 1; i < end; ++i)
+        {
+            const auto frame = SimdFloat4::load (zone.frames.getFrame (i));
+            lowest = lowest.min (frame);
+            highest = highest.max (frame);
+        }
+
+        float mins[QuadFrameBuffer::numChannels], maxs[QuadFrameBuffer::numChannels];
+        lowest.store (mins);
+        highest.store (maxs);
+
+        for (int channel = 0; channel < summary->numChannels; ++channel)
+        {
+            const auto index = (size_t) (channel * finest.numBins + bin);
+            finest.mins[index] = mins[channel];
+            finest.maxs[index] = maxs[channel];
+        }
+    }
+
+    summary->levels.push_back (std::move (finest));
+
+    // ...every coarser one from the level below it
+    for (int levelIndex = 1; levelIndex < numLevels; ++levelIndex)
+    {
+        const auto& source = summary->levels.back();
+
+        Level level;
+        level.samplesPerBin = source.samplesPerBin * levelRatio;
+        level.numBins = (source.numBins + levelRatio - 1) / levelRatio;
+        level.mins.resize ((size_t) (level.numBins * summary->numChannels));
+        level.maxs.resize (level.mins.size());
+
+        for (int channel = 0; channel < summary->numChannels; ++channel)
+        {
+            for (int bin = 0; bin < level.numBins; ++bin)
+            {
+                const int first = bin * levelRatio;
+                const int last = juce::jmin (first + levelRatio, source.numBins);
+                const auto sourceOffset = (size_t) (channel * source.numBins);
+
+                const auto index = (size_t) (channel * level.numBins + bin);
+                level.mins[index] = *std::min_element (source.mins.begin() + (long) (sourceOffset + (size_t) first), source.mins.begin() + (long) (sourceOffset + (size_t) last));
+                level.maxs[index] = *std::max_element (source.maxs.begin() + (long) (sourceOffset + (size_t) first), source.maxs.begin() + (long) (sourceOffset + (size_t) last));
+            }
+        }
+
+        summary->levels.push_back (std::move (level));
+    }
+
+    return summary;
+}
+
+const WaveformSummary::Level& WaveformSummary::getLevelFor (double samplesPerPixel) const
+{
+    jassert (! levels.empty());
+
+    for (auto level = levels.rbegin(); level != levels.rend(); ++level)
+        if (level->samplesPerBin <= samplesPerPixel)
+            return *level;
+
+    return levels.front();
+}
+
+//==============================================================================
+ThumbnailCache::ThumbnailCache()
+    : directory (juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                    .getChildFile ("Spheringer").getChildFile ("ThumbnailCache"))
+{
+}
+
+void ThumbnailCache::setThumbnail (int noteNumber, int layer, const ZoneThumbnail& thumbnail)
+{
+    {
+        RealtimeGuard::check ("ThumbnailCache lock");
+        const juce::ScopedLock sl (lock);
+        auto& stored = thumbnails[{ noteNumber, layer }];
+        stored = thumbnail;
+        stored.layer = layer;
+    }
+
+    sendChangeMessage();
+}
+
+void ThumbnailCache::removeThumbnail (int noteNumber, int layer)
+{
+    {
+        RealtimeGuard::check ("ThumbnailCache lock");
+        const juce::ScopedLock sl (lock);
+        thumbnails.erase ({ noteNumber, layer });
+    }
+
+    sendChangeMessage();
+}
+
+void ThumbnailCache::clear()
+{
+    {
+        RealtimeGuard::check ("ThumbnailCache lock");
+        const juce::ScopedLock sl (lock);
+        thumbnails.clear();
+    }
+
+    sendChangeMessage();
+}
+
+ThumbnailCache::ZoneThumbnail ThumbnailCache::getThumbnail (int noteNumber, int layer) const
+{
+    RealtimeGuard::check ("ThumbnailCache lock");
+    const juce::ScopedLock sl (lock);
+
+    // Same search as the velocity layers on the audio thread: nearest first, the softer one on a tie
+    for (int distance = 0; distance < DynamicLayer::numLayers; ++distance)
+    {
+        for (const int candidate : { layer - distance, layer + distance })
+        {
+            const auto iterator = thumbnails.find ({ noteNumber, candidate });
+
+            if (iterator != thumbnails.end())
+                return iterator->second;
+        }
+    }
+
+    return {};
+}
+
+juce::Array<int> ThumbnailCache::getNoteNumbers() const
+{
+    RealtimeGuard::check ("ThumbnailCache lock");
+    const juce::ScopedLock sl (lock);
+    juce::Array<int> notes;
+
+    for (const auto& entry : thumbnails)
+        if (notes.isEmpty() || notes.getLast() != entry.first.first)
+            notes.add (entry.first.first);
+
+    return notes;
+}
+
+//==============================================================================
+juce::File ThumbnailCache::getCacheFile (const juce::String& contentHash) const
+{
+    return directory.getChildFile (contentHash + ".thumb");
+}
+
+std::shared_ptr<const WaveformSummary> ThumbnailCache::loadFromDisk (const juce::String& contentHash) const
+{
+    RealtimeGuard::check ("ThumbnailCache::loadFromDisk");
+
+    if (contentHash.isEmpty())
+        return {};
+
+    juce::FileInputStream stream (getCacheFile (contentHash));
+
+    if (stream.failedToOpen() || stream.readInt() != fileMagic || stream.readInt() != formatVersion)
+        return {};
+
+    auto summary = std::make_shared<WaveformSummary>();
+    summary->numChannels = stream.readInt();
+    summary->numSamples = stream.readInt();
+    summary->sampleRate = stream.readDouble();
+    summary->rootNote = stream.readInt();
+    summary->tuningCents = stream.readFloat();
+    summary->loop.start = stream.readInt();
+    summary->loop.end = stream.readInt();
+
+    auto& trim = summary->trim;
+    trim.sourceLength = stream.readInt();
+    trim.start = stream.readInt();
+    trim.length = stream.readInt();
+    trim.fadeInLength = stream.readInt();
+    trim.fadeOutLength = stream.readInt();
+
+    const int numStoredLevels = stream.readInt();
+
+    // One per channel of the file, which may have fewer than the zone once it's upmixed, or more than the four it keeps
+    const int numSourceChannels = stream.readInt();
+
+    if (summary->numChannels <= 0 || summary->numChannels > QuadFrameBuffer::numChannels || summary->numSamples <= 0
+         || numStoredLevels <= 0 || numStoredLevels > 16
+         || numSourceChannels <= 0 || numSourceChannels > maxSourceChannels
+         || trim.start < 0 || trim.length < summary->numSamples || trim.start + trim.length > trim.sourceLength)
+        return {};
+
+    for (int channel = 0; channel < numSourceChannels; ++channel)
+        trim.dcOffsets.push_back (stream.readFloat());
+
+    for (int i = 0; i < numStoredLevels; ++i)
+    {
+        WaveformSummary::Level level;
+        level.samplesPerBin = stream.readInt();
+        level.numBins = stream.readInt();
+
+        if (level.samplesPerBin <= 0 || level.numBins != (summary->numSamples + level.samplesPerBin - 1) / level.samplesPerBin)
+            return {};
+
+        level.mins.resize ((size_t) (level.numBins * summary->numChannels));
+        level.maxs.resize (level.mins.size());
+
+        const auto numBytes = (int) (level.mins.size() * sizeof (float));
+
+        if (stream.read (level.mins.data(), numBytes) != numBytes || stream.read (level.maxs.data(), numBytes) != numBytes)
+            return {};
+
+        summary->levels.push_back (std::move (level));
+    }
+
+    return summary;
+}
+
+void ThumbnailCache::saveToDisk (const juce::String& contentHash, const WaveformSummary& summary) const
+{
+    RealtimeGuard::check ("ThumbnailCache::saveToDisk");
+
+    if (contentHash.isEmpty() || ! directory.createDirectory().wasOk())
+        return;
+
+    // Written next to the real file and moved over it, so a crash never leaves half a thumbnail behind
+    juce::TemporaryFile temp (getCacheFile (contentHash));
+
+    {
+        juce::FileOutputStream stream (temp.getFile());
+
+        if (stream.failedToOpen())
+            return;
+
+        stream.writeInt (fileMagic);
+        stream.writeInt (formatVersion);
+        stream.writeInt (summary.numChannels);
+        stream.writeInt (summary.numSamples);
+        stream.writeDouble (summary.sampleRate);
+        stream.writeInt (summary.rootNote);
+        stream.writeFloat (summary.tuningCents);
+        stream.writeInt (summary.loop.start);
+        stream.writeInt (summary.loop.end);
+        stream.writeInt (summary.trim.sourceLength);
+        stream.writeInt (summary.trim.start);
+        stream.writeInt (summary.trim.length);
+        stream.writeInt (summary.trim.fadeInLength);
+        stream.writeInt (summary.trim.fadeOutLength);
+        stream.writeInt ((int) summary.levels.size());
+        stream.writeInt ((int) summary.trim.dcOffsets.size());
+
+        for (auto offset : summary.trim.dcOffsets)
+            stream.writeFloat (offset);
+
+        for (const auto& level : summary.levels)
+        {
+            stream.writeInt (level.samplesPerBin);
+            stream.writeInt (level.numBins);
+            stream.write (level.mins.data(), level.mins.size() * sizeof (float));
+            stream.write (level.maxs.data(), level.maxs.size() * sizeof (float));
+        }
+    }
+
+    temp.overwriteTargetFileWithTemporary();
+}
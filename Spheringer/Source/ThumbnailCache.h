@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    ThumbnailCache.h
+    Min/max waveform summaries of the loaded zones, kept in memory for the
+    editor and on disk so a library that was opened before draws instantly.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleZone.h"
+
+//==============================================================================
+/** Min/max pairs at several resolutions, each level 4x coarser than the last. */
+struct WaveformSummary
+{
+    struct Level
+    {
+        int samplesPerBin = 0;
+        int numBins = 0;
+        std::vector<float> mins, maxs; // channel-major: [channel * numBins + bin]
+    };
+
+    int numChannels = 0;
+    int numSamples = 0;
+    double sampleRate = 44100.0;
+    int rootNote = 0;
+    float tuningCents = 0.0f;
+    LoopRegion loop;
+    SampleTrim trim;
+    std::vector<Level> levels;
+
+    // Summarises a zone as it will be played, i.e. after loop processing
+    static std::shared_ptr<WaveformSummary> create (const SampleZone& zone);
+
+    // Finest level with at least `samplesPerPixel` samples per bin (or the finest one there is)
+    const Level& getLevelFor (double samplesPerPixel) const;
+};
+
+//==============================================================================
+/** Filled by the loader thread, read by the editor. Sends a change message
+    whenever a thumbnail is added, so the editor can repaint. There is one
+    thumbnail per dynamic layer of a note.
+*/
+class ThumbnailCache  : public juce::ChangeBroadcaster
+{
+public:
+    //==============================================================================
+    ThumbnailCache();
+
+    struct ZoneThumbnail
+    {
+        juce::String fileName;
+        std::shared_ptr<const WaveformSummary> summary;
+        int layer = DynamicLayer::mezzoforte; // filled in by the cache
+    };
+
+    void setThumbnail (int noteNumber, int layer, const ZoneThumbnail& thumbnail);
+    void removeThumbnail (int noteNumber, int layer);
+    void clear();
+
+    // The layer asked for, or the nearest one the note has
+    ZoneThumbnail getThumbnail (int noteNumber, int layer) const;
+
+    // Every note with at least one layer, lowest first
+    juce::Array<int> getNoteNumbers() const;
+
+    //==============================================================================
+    // Disk cache, keyed by the file's content hash. Loader thread only.
+    std::shared_ptr<const WaveformSummary> loadFromDisk (const juce::String& contentHash) const;
+    void saveToDisk (const juce::String& contentHash, const WaveformSummary& summary) const;
+
+    // Bump whenever the loader changes what ends up in a zone, so stale thumbnails are recomputed
+    static constexpr int formatVersion = 5;
+
+private:
+    //==============================================================================
+    juce::File getCacheFile (const juce::String& contentHash) const;
+
+    juce::File directory;
+
+    juce::CriticalSection lock;
+    std::map<std::pair<int, int>, ZoneThumbnail> thumbnails; // keyed by note, then layer
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThumbnailCache)
+};
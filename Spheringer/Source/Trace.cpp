@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+    Trace.cpp
+
+  ==============================================================================
+*/
+
+#include "Trace.h"
+
+#if SPHERINGER_TRACING
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        juce::int64 start, end;
+    };
+
+    // One writer, its own thread; saveChromeJson reads it from the message thread
+    struct ThreadBuffer
+    {
+        std::atomic<bool> claimed {false};
+        std::atomic<const char*> threadName {nullptr};
+        std::atomic<juce::uint64> numWritten {0};
+        Event events[Trace::eventsPerThread];
+    };
+
+    ThreadBuffer threadBuffers[Trace::maxThreads];
+
+    // Buffers nobody has written to come first, so a thread that exited keeps its events for as long as possible
+    ThreadBuffer* claimBuffer (int first, int last) noexcept
+    {
+        for (const bool unusedOnly : { true, false })
+        {
+            for (int i = first; i < last; ++i)
+            {
+                auto& buffer = threadBuffers[i];
+                bool expected = false;
+
+                if (unusedOnly && buffer.numWritten.load (std::memory_order_relaxed) != 0)
+                    continue;
+
+                if (buffer.claimed.compare_exchange_strong (expected, true))
+                {
+                    buffer.threadName.store (nullptr, std::memory_order_relaxed);
+                    buffer.numWritten.store (0, std::memory_order_release);
+                    return &buffer;
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Gives the buffer back when the thread exits, so thread pools that come and go don't use up the pool
+    struct Claim
+    {
+        ~Claim()
+        {
+            if (buffer != nullptr)
+                buffer->claimed.store (false, std::memory_order_release);
+        }
+
+        ThreadBuffer* buffer = nullptr;
+        bool outOfBuffers = false;
+    };
+
+    thread_local Claim claim;
+
+    // Audio threads take the reserved buffers first. Threads that find none left go untraced.
+    ThreadBuffer* getThreadBuffer (bool isAudioThread = false) noexcept
+    {
+        if (claim.buffer == nullptr && ! claim.outOfBuffers)
+        {
+            if (isAudioThread)
+                claim.buffer = claimBuffer (0, Trace::maxAudioThreads);
+
+            if (claim.buffer == nullptr)
+                claim.buffer = claimBuffer (Trace::maxAudioThreads, Trace::maxThreads);
+
+            claim.outOfBuffers = claim.buffer == nullptr;
+        }
+
+        return claim.buffer;
+    }
+}
+
+//==============================================================================
+Trace::Scope::Scope (const char* eventName) noexcept
+    : name (eventName), start (juce::Time::getHighResolutionTicks())
+{
+}
+
+Trace::Scope::~Scope() noexcept
+{
+    if (auto* buffer = getThreadBuffer())
+    {
+        const auto index = buffer->numWritten.load (std::memory_order_relaxed);
+        buffer->events[index % eventsPerThread] = { name, start, juce::Time::getHighResolutionTicks() };
+        buffer->numWritten.store (index + 1, std::memory_order_release);
+    }
+}
+
+void Trace::setThreadName (const char* threadName, bool isAudioThread) noexcept
+{
+    if (auto* buffer = getThreadBuffer (isAudioThread))
+        buffer->threadName.store (threadName, std::memory_order_relaxed);
+}
+
+//==============================================================================
+juce::Result Trace::saveChromeJson (const juce::File& file)
+{
+    struct Track
+    {
+        juce::String name;
+        std::vector<Event> events;
+    };
+
+    std::vector<Track> tracks;
+    juce::int64 origin = std::numeric_limits<juce::int64>::max();
+
+    for (int i = 0; i < maxThreads; ++i)
+    {
+        auto& buffer = threadBuffers[i];
+        const auto end = buffer.numWritten.load (std::memory_order_acquire);
+
+        if (end == 0)
+            continue;
+        const auto begin = end > (juce::uint64) eventsPerThread ? end - (juce::uint64) eventsPerThread : 0;
+
+        Track track;
+        const auto* threadName = buffer.threadName.load (std::memory_order_relaxed);
+        track.name = threadName != nullptr ? juce::String (threadName) : "Thread " + juce::String (i + 1);
+
+        for (auto index = begin; index < end; ++index)
+            track.events.push_back (buffer.events[index % eventsPerThread]);
+
+        // Whatever the thread wrapped around onto while we were copying may be torn, so drop it.
+        // It is writing the slot of event `after` right now, which is also the slot of event `after - eventsPerThread`.
+        const auto after = buffer.numWritten.load (std::memory_order_acquire);
+        const auto firstIntact = after >= (juce::uint64) eventsPerThread ? after - (juce::uint64) eventsPerThread + 1 : 0;
+
+        if (firstIntact > begin)
+            track.events.erase (track.events.begin(), track.events.begin() + (long) juce::jmin ((juce::uint64) track.events.size(), firstIntact - begin));
+
+        for (const auto& event : track.events)
+            origin = juce::jmin (origin, event.start);
+
+        tracks.push_back (std::move (track));
+    }
+
+    const auto toMicroseconds = [] (juce::int64 ticks) { return juce::Time::highResolutionTicksToSeconds (ticks) * 1.0e6; };
+
+    juce::Array<juce::var> traceEvents;
+
+    for (size_t tid = 0; tid < tracks.size(); ++tid)
+    {
+        auto* metadata = new juce::DynamicObject();
+        metadata->setProperty ("name", "thread_name");
+        metadata->setProperty ("ph", "M");
+        metadata->setProperty ("pid", 1);
+        metadata->setProperty ("tid", (int) tid);
+
+        auto* args = new juce::DynamicObject();
+        args->setProperty ("name", tracks[tid].name);
+        metadata->setProperty ("args", juce::var (args));
+        traceEvents.add (juce::var (metadata));
+
+        for (const auto& event : tracks[tid].events)
+        {
+            // Complete events: a start and a duration, in microseconds
+            auto* object = new juce::DynamicObject();
+            object->setProperty ("name", event.name);
+            object->setProperty ("ph", "X");
+            object->setProperty ("pid", 1);
+            object->setProperty ("tid", (int) tid);
+            object->setProperty ("ts", toMicroseconds (event.start - origin));
+            object->setProperty ("dur", toMicroseconds (event.end - event.start));
+            traceEvents.add (juce::var (object));
+        }
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("traceEvents", traceEvents);
+    root->setProperty ("displayTimeUnit", "ms");
+
+    if (! file.replaceWithText (juce::JSON::toString (juce::var (root), true)))
+        return juce::Result::fail ("Couldn't write " + file.getFullPathName());
+
+    return juce::Result::ok();
+}
+
+#endif
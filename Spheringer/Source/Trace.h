@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    Trace.h
+    Timeline of scoped events on every thread, saved as Chrome/Perfetto JSON.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Off by default; define it to 0 or 1 in the project settings to override.
+// When off, SPHERINGER_TRACE_SCOPE and SPHERINGER_TRACE_THREAD expand to nothing.
+#ifndef SPHERINGER_TRACING
+ #define SPHERINGER_TRACING 0
+#endif
+
+//==============================================================================
+/**
+    A Scope records when it was created and destroyed into a buffer owned by
+    its thread. The buffers are claimed from a fixed pool the first time a
+    thread records anything, so nothing allocates, locks or waits, and the
+    audio thread can trace as freely as the loader. A thread gives its buffer
+    back when it exits; until another thread claims it, its events are still
+    saved. Part of the pool is kept for audio threads, so the worker threads
+    of many instances can't leave the most important track untraced.
+
+    Each buffer keeps the most recent eventsPerThread events. saveChromeJson()
+    copies them out while the threads carry on, and the result opens in
+    chrome://tracing or ui.perfetto.dev. Event names must be string literals.
+*/
+namespace Trace
+{
+    static constexpr int maxThreads = 64;
+    static constexpr int maxAudioThreads = 16; // of maxThreads, only claimed through SPHERINGER_TRACE_AUDIO_THREAD
+    static constexpr int eventsPerThread = 4096;
+
+   #if SPHERINGER_TRACING
+    struct Scope
+    {
+        explicit Scope (const char* eventName) noexcept;
+        ~Scope() noexcept;
+
+        const char* name;
+        juce::int64 start;
+    };
+
+    // Names the calling thread's track in the timeline. Call it before anything else is traced on an audio thread.
+    void setThreadName (const char* threadName, bool isAudioThread = false) noexcept;
+
+    // Message thread. Writes every buffered event; fails if the file can't be written.
+    juce::Result saveChromeJson (const juce::File& file);
+   #else
+    struct Scope { explicit Scope (const char*) noexcept {} };
+
+    inline void setThreadName (const char*, bool = false) noexcept {}
+    inline juce::Result saveChromeJson (const juce::File&) { return juce::Result::fail ("Built without SPHERINGER_TRACING"); }
+   #endif
+}
+
+#if SPHERINGER_TRACING
+ #define SPHERINGER_TRACE_SCOPE(name)   const Trace::Scope JUCE_JOIN_MACRO (traceScope, __LINE__) (name)
+ #define SPHERINGER_TRACE_THREAD(name)  Trace::setThreadName (name)
+ #define SPHERINGER_TRACE_AUDIO_THREAD(name)  Trace::setThreadName (name, true)
+#else
+ #define SPHERINGER_TRACE_SCOPE(name)
+ #define SPHERINGER_TRACE_THREAD(name)
+ #define SPHERINGER_TRACE_AUDIO_THREAD(name)
+#endif
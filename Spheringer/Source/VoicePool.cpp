@@ -0,0 +1,282 @@
+/*
+  ==============================================================================
+
+    VoicePool.cpp
+
+  ==============================================================================
+*/
+
+#include "VoicePool.h"
+#include "Trace.h"
+
+namespace
+{
+    // The parallel renderer's per-thread mixes
+   #if SPHERINGER_INTERLEAVED_MIX
+    void setMixSize (QuadFrameBuffer& mix, int, int numSamples) { mix.setSize (numSamples); }
+    int getMixSize (const QuadFrameBuffer& mix) noexcept     { return mix.getNumFrames(); }
+
+    void addMix (QuadFrameBuffer& destination, int destinationStart, const QuadFrameBuffer& mix, int numSamples) noexcept
+    {
+        destination.addFrom (mix, destinationStart, 0, numSamples);
+    }
+   #else
+    void setMixSize (juce::AudioSampleBuffer& mix, int numChannels, int numSamples) { mix.setSize (numChannels, numSamples); }
+    int getMixSize (const juce::AudioSampleBuffer& mix) noexcept                   { return mix.getNumSamples(); }
+
+    void addMix (juce::AudioSampleBuffer& destination, int destinationStart, const juce::AudioSampleBuffer& mix, int numSamples) noexcept
+    {
+        for (int channel = 0; channel < juce::jmin (destination.getNumChannels(), mix.getNumChannels()); ++channel)
+            destination.addFrom (channel, destinationStart, mix, channel, 0, numSamples);
+    }
+   #endif
+}
+
+//==============================================================================
+void VoicePool::prepare (double sampleRate, int maximumBlockSize, int numChannels, bool parallelRendering)
+{
+    for (auto& voice : voices)
+        voice.prepare (sampleRate, maximumBlockSize, numChannels);
+
+    stealFadeSamples = juce::roundToInt (stealFadeSeconds * sampleRate);
+
+    // The calling thread renders the first share itself, every other core gets one of its own
+    renderJobs.clear();
+    renderThreads.reset();
+
+    const int numShares = parallelRendering ? juce::SystemStats::getNumCpus() : 1;
+
+    if (numShares > 1)
+    {
+        renderThreads = std::make_unique<juce::ThreadPool> (numShares - 1);
+
+        for (int share = 1; share < numShares; ++share)
+            renderJobs.push_back (std::make_unique<RenderJob> (*this, share, numChannels, maximumBlockSize));
+    }
+}
+
+void VoicePool::setRenderQuality (RenderQuality newQuality) noexcept
+{
+    if (quality == newQuality)
+        return;
+
+    quality = newQuality;
+
+    for (auto& voice : voices)
+        voice.setRenderQuality (quality);
+}
+
+void VoicePool::setEnvelopeParameters (const juce::ADSR::Parameters& params)
+{
+    for (auto& voice : voices)
+        voice.setEnvelopeParameters (params);
+}
+
+int VoicePool::noteOn (int midiNoteNumber, const SampleLibrary::Layers& zones, float noteAzimuth)
+{
+    int numStolen = 0;
+
+    if (getNumSoundingVoices() >= polyphonyLimit)
+    {
+        if (auto* victim = findVoiceToSteal())
+        {
+            victim->steal (stealFadeSamples);
+            ++numStolen;
+        }
+    }
+
+    auto* voice = findFreeVoice();
+
+    // Even the spares are busy fading: cut the quietest of those instead
+    if (voice == nullptr)
+    {
+        for (auto& candidate : voices)
+            if (voice == nullptr || candidate.getLevel() < voice->getLevel())
+                voice = &candidate;
+
+        voice->kill();
+    }
+
+    voice->startNote (midiNoteNumber, zones, ++noteOnCounter, noteAzimuth, sharedPosition, dynamics);
+    return numStolen;
+}
+
+void VoicePool::noteOff (int midiNoteNumber)
+{
+    for (auto& voice : voices)
+        if (voice.isActive() && voice.getNoteNumber() == midiNoteNumber && ! voice.isReleasing())
+            voice.stopNote();
+}
+
+void VoicePool::killAll()
+{
+    for (auto& voice : voices)
+        voice.kill();
+}
+
+void VoicePool::renderNextBlock (MixBus& outputBuffer, int startSample, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    if (quality == RenderQuality::offline && renderThreads != nullptr)
+    {
+        renderInParallel (outputBuffer, startSample, numSamples);
+        return;
+    }
+
+    SPHERINGER_TRACE_SCOPE ("renderVoices");
+
+    for (auto& voice : voices)
+        if (voice.isActive())
+            voice.renderNextBlock (outputBuffer, startSample, numSamples);
+}
+
+//==============================================================================
+VoicePool::RenderJob::RenderJob (VoicePool& ownerToUse, int indexToUse, int numChannels, int maximumBlockSize)
+    : juce::ThreadPoolJob ("Spheringer voice renderer"),
+      owner (ownerToUse),
+      index (indexToUse)
+{
+    setMixSize (mix, numChannels, maximumBlockSize);
+}
+
+juce::ThreadPoolJob::JobStatus VoicePool::RenderJob::runJob()
+{
+    SPHERINGER_TRACE_THREAD ("Voice renderer");
+    SPHERINGER_TRACE_SCOPE ("renderShare");
+
+    mix.clear (0, numSamples);
+    owner.renderShare (index, mix, 0, numSamples);
+    return jobHasFinished;
+}
+
+void VoicePool::renderInParallel (MixBus& outputBuffer, int startSample, int numSamples)
+{
+    SPHERINGER_TRACE_SCOPE ("renderVoicesInParallel");
+
+    numActiveVoices = 0;
+
+    for (auto& voice : voices)
+        if (voice.isActive())
+            activeVoices[(size_t) numActiveVoices++] = &voice;
+
+    // The job buffers are only as big as the block size we were prepared with
+    const int chunkSize = getMixSize (renderJobs.front()->mix);
+    const int numJobs = juce::jmin ((int) renderJobs.size(), numActiveVoices - 1);
+
+    for (int done = 0; done < numSamples; done += chunkSize)
+    {
+        const int chunk = juce::jmin (chunkSize, numSamples - done);
+
+        for (int i = 0; i < numJobs; ++i)
+        {
+            renderJobs[(size_t) i]->numSamples = chunk;
+            renderThreads->addJob (renderJobs[(size_t) i].get(), false);
+        }
+
+        renderShare (0, outputBuffer, startSample + done, chunk);
+
+        for (int i = 0; i < numJobs; ++i)
+        {
+            const auto& job = *renderJobs[(size_t) i];
+            renderThreads->waitForJobToFinish (&job, -1);
+            addMix (outputBuffer, startSample + done, job.mix, chunk);
+        }
+    }
+}
+
+void VoicePool::renderShare (int shareIndex, MixBus& buffer, int startSample, int numSamples)
+{
+    // Every share takes every n-th active voice, so no voice is ever touched by two threads
+    const int numShares = juce::jmin ((int) renderJobs.size(), numActiveVoices - 1) + 1;
+
+    for (int i = shareIndex; i < numActiveVoices; i += numShares)
+        activeVoices[(size_t) i]->renderNextBlock (buffer, startSample, numSamples);
+}
+
+void VoicePool::setSharedSpatialPosition (const SpatialPosition& position) noexcept
+{
+    sharedPosition = position;
+
+    for (auto& voice : voices)
+        if (voice.isActive())
+            voice.setSharedSpatialPosition (position);
+}
+
+void VoicePool::setDynamics (float newDynamics) noexcept
+{
+    dynamics = juce::jlimit (0.0f, 1.0f, newDynamics);
+
+    for (auto& voice : voices)
+        if (voice.isActive())
+            voice.setDynamics (dynamics);
+}
+
+//==============================================================================
+void VoicePool::setPolyphonyLimit (int newLimit) noexcept
+{
+    polyphonyLimit = juce::jlimit (minPolyphony, maxPolyphony, newLimit);
+}
+
+int VoicePool::enforcePolyphonyLimit()
+{
+    int numStolen = 0;
+
+    for (int excess = getNumSoundingVoices() - polyphonyLimit; excess > 0; --excess)
+    {
+        auto* victim = findVoiceToSteal();
+
+        if (victim == nullptr)
+            break;
+
+        victim->steal (stealFadeSamples);
+        ++numStolen;
+    }
+
+    return numStolen;
+}
+
+int VoicePool::getNumActiveVoices() const noexcept
+{
+    return (int) std::count_if (voices.begin(), voices.end(), [] (const SamplerVoice& v) { return v.isActive(); });
+}
+
+int VoicePool::getNumSoundingVoices() const noexcept
+{
+    return (int) std::count_if (voices.begin(), voices.end(), [] (const SamplerVoice& v) { return v.isActive() && ! v.isBeingStolen(); });
+}
+
+//==============================================================================
+SamplerVoice* VoicePool::findFreeVoice() noexcept
+{
+    for (auto& voice : voices)
+        if (! voice.isActive())
+            return &voice;
+
+    return nullptr;
+}
+
+SamplerVoice* VoicePool::findVoiceToSteal() noexcept
+{
+    // Released notes go first, then the quietest, then the oldest
+    const auto isBetterVictim = [] (const SamplerVoice& a, const SamplerVoice& b)
+    {
+        if (a.isReleasing() != b.isReleasing())
+            return a.isReleasing();
+
+        if (a.getLevel() != b.getLevel())
+            return a.getLevel() < b.getLevel();
+
+        return a.getNoteOnOrder() < b.getNoteOnOrder();
+    };
+
+    SamplerVoice* victim = nullptr;
+
+    for (auto& voice : voices)
+        if (voice.isActive() && ! voice.isBeingStolen())
+            if (victim == nullptr || isBetterVictim (voice, *victim))
+                victim = &voice;
+
+    return victim;
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    VoicePool.h
+    Fixed set of SamplerVoices with an adjustable polyphony limit.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SamplerVoice.h"
+
+//==============================================================================
+/**
+    All voices are allocated up front. The polyphony limit can be lowered at any
+    time; voices above it are stolen with a short fade rather than cut, so a few
+    spare voices are kept around to play new notes while the stolen ones fade.
+
+    When rendering offline the voices are shared out between worker threads,
+    each mixing into a buffer of its own, and summed when they are all done.
+*/
+class VoicePool
+{
+public:
+    //==============================================================================
+    static constexpr int maxPolyphony = 32;
+    static constexpr int minPolyphony = 4;
+
+    // With parallelRendering, threads are started for offline rendering. Only call this off the audio thread.
+    void prepare (double sampleRate, int maximumBlockSize, int numChannels, bool parallelRendering = false);
+    void setEnvelopeParameters (const juce::ADSR::Parameters& params);
+
+    // Audio thread, every block: offline renders use the parallel path, if prepared for it, and better interpolation
+    void setRenderQuality (RenderQuality newQuality) noexcept;
+
+    // Plays every layer that isn't null. Returns the number of voices that had to be stolen to make room.
+    int noteOn (int midiNoteNumber, const SampleLibrary::Layers& zones, float noteAzimuth = 0.0f);
+    void noteOff (int midiNoteNumber);
+    void killAll();
+
+    // Adds every active voice into the mix bus
+    void renderNextBlock (MixBus& outputBuffer, int startSample, int numSamples);
+
+    // Position shared by every voice, on top of each note's own azimuth. Voices glide there at control rate.
+    void setSharedSpatialPosition (const SpatialPosition& position) noexcept;
+
+    // Where every voice sits between its softest (0) and loudest (1) layer
+    void setDynamics (float newDynamics) noexcept;
+    float getDynamics() const noexcept { return dynamics; }
+
+    //==============================================================================
+    void setPolyphonyLimit (int newLimit) noexcept;
+    int getPolyphonyLimit() const noexcept { return polyphonyLimit; }
+
+    // Steals the quietest voices (oldest first on a tie) until no more than the limit are left
+    int enforcePolyphonyLimit();
+
+    int getNumActiveVoices() const noexcept;   // everything that is making sound
+    int getNumSoundingVoices() const noexcept; // same, minus the voices already fading out after a steal
+
+private:
+    //==============================================================================
+    // One share of the active voices, mixed into its own buffer
+    struct RenderJob  : public juce::ThreadPoolJob
+    {
+        RenderJob (VoicePool& ownerToUse, int indexToUse, int numChannels, int maximumBlockSize);
+        JobStatus runJob() override;
+
+        VoicePool& owner;
+        const int index;
+        MixBus mix;
+        int numSamples = 0;
+    };
+
+    SamplerVoice* findFreeVoice() noexcept;
+    SamplerVoice* findVoiceToSteal() noexcept;
+    void renderInParallel (MixBus& outputBuffer, int startSample, int numSamples);
+    void renderShare (int shareIndex, MixBus& buffer, int startSample, int numSamples);
+
+    static constexpr int numSpareVoices = 8;
+    static constexpr double stealFadeSeconds = 0.005;
+
+    std::array<SamplerVoice, maxPolyphony + numSpareVoices> voices;
+    int polyphonyLimit = maxPolyphony;
+    int stealFadeSamples = 0;
+    juce::uint32 noteOnCounter = 0;
+    SpatialPosition sharedPosition;
+    float dynamics = 0.5f;
+
+    RenderQuality quality = RenderQuality::realtime;
+    std::unique_ptr<juce::ThreadPool> renderThreads;
+    std::vector<std::unique_ptr<RenderJob>> renderJobs;
+    std::array<SamplerVoice*, maxPolyphony + numSpareVoices> activeVoices {};
+    int numActiveVoices = 0;
+};
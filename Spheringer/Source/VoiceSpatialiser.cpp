@@ -0,0 +1,277 @@
+/*
+  ==============================================================================
+
+    VoiceSpatialiser.cpp
+
+  ==============================================================================
+*/
+
+#include "VoiceSpatialiser.h"
+
+namespace
+{
+    using Matrix4 = std::array<std::array<float, 4>, 4>;
+
+    // Quad output order is L, R, Ls, Rs at +45, -45, +135 and -135 degrees.
+    // The signal components are W (omni), X (front), Y (left) and Q, the one
+    // pattern a square of speakers has beyond first order (+ - - +).
+    // The four rows are orthogonal, so decoding is just the transpose, scaled.
+    constexpr float c = juce::MathConstants<float>::sqrt2 * 0.5f;
+
+    constexpr Matrix4 encode {{ { 1.0f,  1.0f,  1.0f,  1.0f },
+                                {    c,     c,    -c,    -c },
+                                {    c,    -c,     c,    -c },
+                                { 1.0f, -1.0f, -1.0f,  1.0f } }};
+
+    constexpr Matrix4 decode {{ { 0.25f,  c * 0.5f,  c * 0.5f,  0.25f },
+                                { 0.25f,  c * 0.5f, -c * 0.5f, -0.25f },
+                                { 0.25f, -c * 0.5f,  c * 0.5f, -0.25f },
+                                { 0.25f, -c * 0.5f, -c * 0.5f,  0.25f } }};
+
+    // Front gain of a point source, as high as it goes without the speaker behind going negative
+    constexpr float pointSourceDirectivity = c;
+
+    Matrix4 multiply (const Matrix4& a, const Matrix4& b) noexcept
+    {
+        Matrix4 result {};
+
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                for (int k = 0; k < 4; ++k)
+                    result[(size_t) row][(size_t) column] += a[(size_t) row][(size_t) k] * b[(size_t) k][(size_t) column];
+
+        return result;
+    }
+
+    // How sources with fewer than four channels are laid out on the quad before encoding
+    Matrix4 spreadOverQuad (int numSourceChannels) noexcept
+    {
+        Matrix4 spread {};
+
+        if (numSourceChannels >= 4)
+        {
+            for (int i = 0; i < 4; ++i)
+                spread[(size_t) i][(size_t) i] = 1.0f;
+        }
+        else if (numSourceChannels >= 2)
+        {
+            // Left to L and Ls, right to R and Rs
+            spread[0][0] = spread[2][0] = c;
+            spread[1][1] = spread[3][1] = c;
+        }
+        else if (numSourceChannels == 1)
+        {
+            for (int i = 0; i < 4; ++i)
+                spread[(size_t) i][0] = 0.5f;
+        }
+
+        return spread;
+    }
+}
+
+//==============================================================================
+void VoiceSpatialiser::reset (const SpatialPosition& position, int numSourceChannels) noexcept
+{
+    numSources = juce::jlimit (0, numOutputChannels, numSourceChannels);
+    currentPosition = target = position;
+    current = computeMatrix (position, numSources);
+}
+
+VoiceSpatialiser::Matrix VoiceSpatialiser::computeMatrix (const SpatialPosition& position, int numSourceChannels) noexcept
+{
+    const float width = juce::jlimit (0.0f, 1.0f, position.width);
+    const float cosAzimuth = std::cos (position.azimuth), sinAzimuth = std::sin (position.azimuth);
+
+    // A flat quad can't reproduce height: tilting the image up leaves less of it directional
+    const float horizontal = std::cos (position.elevation);
+
+    // Narrow towards a point source straight ahead, before rotating
+    Matrix4 narrow {{ { 1.0f, 0.0f, 0.0f, 0.0f },
+                      { (1.0f - width) * pointSourceDirectivity, width, 0.0f, 0.0f },
+                      { 0.0f, 0.0f, width, 0.0f },
+                      { 0.0f, 0.0f, 0.0f, width } }};
+
+    // X and Y turn with the azimuth. Q turns at twice the rate, and its partner
+    // pattern doesn't exist on a square of speakers, so only its projection survives.
+    Matrix4 rotate {{ { 1.0f, 0.0f, 0.0f, 0.0f },
+                      { 0.0f, cosAzimuth * horizontal, -sinAzimuth * horizontal, 0.0f },
+                      { 0.0f, sinAzimuth * horizontal,  cosAzimuth * horizontal, 0.0f },
+                      { 0.0f, 0.0f, 0.0f, std::cos (2.0f * position.azimuth) * horizontal } }};
+
+    return multiply (decode, multiply (rotate, multiply (narrow, multiply (encode, spreadOverQuad (numSourceChannels)))));
+}
+
+//==============================================================================
+void VoiceSpatialiser::process (const QuadFrameBuffer& source, int sourceStart,
+                                juce::AudioSampleBuffer& output, int outputStart, int numSamples) noexcept
+{
+    processInSegments (source, sourceStart, output, outputStart, numSamples);
+}
+
+void VoiceSpatialiser::process (const QuadFrameBuffer& source, int sourceStart,
+                                QuadFrameBuffer& output, int outputStart, int numSamples) noexcept
+{
+    processInSegments (source, sourceStart, output, outputStart, numSamples);
+}
+
+void VoiceSpatialiser::process (const juce::AudioSampleBuffer& source, int sourceStart,
+                                juce::AudioSampleBuffer& output, int outputStart, int numSamples) noexcept
+{
+    processInSegments (source, sourceStart, output, outputStart, numSamples);
+}
+
+template <typename Source, typename Output>
+void VoiceSpatialiser::processInSegments (const Source& source, int sourceStart,
+                                          Output& output, int outputStart, int numSamples) noexcept
+{
+    while (numSamples > 0)
+    {
+        const int segment = juce::jmin (numSamples, controlInterval);
+
+        if (target != currentPosition)
+        {
+            const auto next = computeMatrix (target, numSources);
+            mixSegment (source, sourceStart, output, outputStart, segment, current, next);
+
+            current = next;
+            currentPosition = target;
+        }
+        else
+        {
+            mixSegment (source, sourceStart, output, outputStart, segment, current, current);
+        }
+
+        sourceStart += segment;
+        outputStart += segment;
+        numSamples -= segment;
+    }
+}
+
+void VoiceSpatialiser::getColumnGains (const Matrix& from, const Matrix& to, int numSamples,
+                                       SimdFloat4 (&gains)[numOutputChannels], SimdFloat4 (&deltas)[numOutputChannels]) const noexcept
+{
+    const float rampStep = 1.0f / (float) numSamples;
+
+    // Columns past numSources are all zero, so the lanes that repeat a mono or stereo source's last channel add nothing
+    for (int in = 0; in < numOutputChannels; ++in)
+    {
+        float start[numOutputChannels], delta[numOutputChannels];
+
+        for (int out = 0; out < numOutputChannels; ++out)
+        {
+            start[out] = from[(size_t) out][(size_t) in];
+            delta[out] = (to[(size_t) out][(size_t) in] - start[out]) * rampStep;
+        }
+
+        // Gain for frame i is start + (i + 1) * delta, so the segment lands exactly on `to`
+        deltas[in] = SimdFloat4::load (delta);
+        gains[in] = SimdFloat4::load (start) + deltas[in];
+    }
+}
+
+void VoiceSpatialiser::mixSegment (const QuadFrameBuffer& source, int sourceStart,
+                                   juce::AudioSampleBuffer& output, int outputStart, int numSamples,
+                                   const Matrix& from, const Matrix& to) const noexcept
+{
+    const int numOutputs = juce::jmin (numOutputChannels, output.getNumChannels());
+    float* destinations[numOutputChannels] = {};
+
+    for (int out = 0; out < numOutputs; ++out)
+        destinations[out] = output.getWritePointer (out, outputStart);
+
+    SimdFloat4 gains[numOutputChannels], deltas[numOutputChannels];
+    getColumnGains (from, to, numSamples, gains, deltas);
+
+    auto g0 = gains[0], g1 = gains[1], g2 = gains[2], g3 = gains[3];
+    const auto d0 = deltas[0], d1 = deltas[1], d2 = deltas[2], d3 = deltas[3];
+
+    const float* input = source.getFrame (sourceStart);
+
+    for (int i = 0; i < numSamples; ++i, input += QuadFrameBuffer::numChannels)
+    {
+        const auto x = SimdFloat4::load (input);
+        const auto front = (g0 * x.broadcastLane<0>()).multiplyAdd (g1, x.broadcastLane<1>());
+        const auto rear = (g2 * x.broadcastLane<2>()).multiplyAdd (g3, x.broadcastLane<3>());
+
+        float mixed[numOutputChannels];
+        (front + rear).store (mixed);
+
+        for (int out = 0; out < numOutputs; ++out)
+            destinations[out][i] += mixed[out];
+
+        g0 = g0 + d0;
+        g1 = g1 + d1;
+        g2 = g2 + d2;
+        g3 = g3 + d3;
+    }
+}
+
+void VoiceSpatialiser::mixSegment (const QuadFrameBuffer& source, int sourceStart,
+                                   QuadFrameBuffer& output, int outputStart, int numSamples,
+                                   const Matrix& from, const Matrix& to) const noexcept
+{
+    SimdFloat4 gains[numOutputChannels], deltas[numOutputChannels];
+    getColumnGains (from, to, numSamples, gains, deltas);
+
+    // In registers, whatever the optimiser makes of the arrays
+    auto g0 = gains[0], g1 = gains[1], g2 = gains[2], g3 = gains[3];
+    const auto d0 = deltas[0], d1 = deltas[1], d2 = deltas[2], d3 = deltas[3];
+
+    const float* input = source.getFrame (sourceStart);
+    float* frame = output.getFrame (outputStart);
+
+    // Each source frame is one load, each output frame one load and one store
+    for (int i = 0; i < numSamples; ++i, input += QuadFrameBuffer::numChannels, frame += numOutputChannels)
+    {
+        const auto x = SimdFloat4::load (input);
+
+        // Two independent sums rather than one chain of four multiply-adds
+        const auto front = (g0 * x.broadcastLane<0>()).multiplyAdd (g1, x.broadcastLane<1>());
+        const auto rear = (g2 * x.broadcastLane<2>()).multiplyAdd (g3, x.broadcastLane<3>());
+        (SimdFloat4::load (frame) + (front + rear)).store (frame);
+
+        g0 = g0 + d0;
+        g1 = g1 + d1;
+        g2 = g2 + d2;
+        g3 = g3 + d3;
+    }
+}
+
+void VoiceSpatialiser::mixSegment (const juce::AudioSampleBuffer& source, int sourceStart,
+                                   juce::AudioSampleBuffer& output, int outputStart, int numSamples,
+                                   const Matrix& from, const Matrix& to) const noexcept
+{
+    const int numOutputs = juce::jmin (numOutputChannels, output.getNumChannels());
+    const int numInputs = juce::jmin (numSources, source.getNumChannels());
+    const int numVectorised = numSamples & ~3;
+    const float rampStep = 1.0f / (float) numSamples;
+
+    for (int out = 0; out < numOutputs; ++out)
+    {
+        float* destination = output.getWritePointer (out, outputStart);
+
+        for (int in = 0; in < numInputs; ++in)
+        {
+            const float start = from[(size_t) out][(size_t) in];
+            const float delta = (to[(size_t) out][(size_t) in] - start) * rampStep;
+
+            if (start == 0.0f && delta == 0.0f)
+                continue;
+
+            const float* input = source.getReadPointer (in, sourceStart);
+
+            // Gain for sample i is start + (i + 1) * delta, so the segment lands exactly on `to`
+            const auto step = SimdFloat4::broadcast (4.0f * delta);
+            auto gain = SimdFloat4::fromValues (start + delta, start + 2.0f * delta, start + 3.0f * delta, start + 4.0f * delta);
+
+            for (int i = 0; i < numVectorised; i += 4)
+            {
+                SimdFloat4::load (destination + i).multiplyAdd (gain, SimdFloat4::load (input + i)).store (destination + i);
+                gain = gain + step;
+            }
+
+            for (int i = numVectorised; i < numSamples; ++i)
+                destination[i] += (start + (float) (i + 1) * delta) * input[i];
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    VoiceSpatialiser.h
+    Places one voice in the quad image by rotating it in the ambisonic domain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SimdFloat4.h"
+#include "QuadFrameBuffer.h"
+
+//==============================================================================
+/** Where a voice sits. Angles in radians; azimuth is anticlockwise from the front. */
+struct SpatialPosition
+{
+    float azimuth = 0.0f;
+    float elevation = 0.0f;
+    float width = 1.0f; // 1 keeps the sample's own image, 0 collapses it to a point
+
+    bool operator== (const SpatialPosition& other) const noexcept
+    {
+        return azimuth == other.azimuth && elevation == other.elevation && width == other.width;
+    }
+
+    bool operator!= (const SpatialPosition& other) const noexcept { return ! operator== (other); }
+};
+
+//==============================================================================
+/**
+    The whole chain - spread the source over the quad, encode to horizontal
+    first order (W, X, Y) plus the quad's quadrupole part, narrow the image,
+    rotate and tilt it, decode back to L, R, Ls, Rs - is linear, so it collapses
+    into one matrix per voice. At the front with full width that matrix is the
+    identity, so quad samples come out untouched.
+
+    The matrix is only recomputed at control rate, every controlInterval
+    samples, and only if the position moved. In between, the gains ramp
+    linearly from the old matrix to the new one.
+*/
+class VoiceSpatialiser
+{
+public:
+    //==============================================================================
+    static constexpr int numOutputChannels = 4;
+    static constexpr int controlInterval = 32;
+
+    // Jumps straight to the position, e.g. on note-on
+    void reset (const SpatialPosition& position, int numSourceChannels) noexcept;
+
+    // Glides there over the next control interval
+    void setTarget (const SpatialPosition& position) noexcept { target = position; }
+
+    // Adds the voice's quad frames into up to four output channels
+    void process (const QuadFrameBuffer& source, int sourceStart,
+                  juce::AudioSampleBuffer& output, int outputStart, int numSamples) noexcept;
+
+    // Same, into interleaved frames: one load, four multiply-adds and one store per frame
+    void process (const QuadFrameBuffer& source, int sourceStart,
+                  QuadFrameBuffer& output, int outputStart, int numSamples) noexcept;
+
+    // Planar channels into planar channels, as voices mixed before their zones were
+    // stored interleaved. Only MixBenchmark uses it, as the reference.
+    void process (const juce::AudioSampleBuffer& source, int sourceStart,
+                  juce::AudioSampleBuffer& output, int outputStart, int numSamples) noexcept;
+
+private:
+    //==============================================================================
+    using Matrix = std::array<std::array<float, numOutputChannels>, numOutputChannels>; // [output][source]
+
+    static Matrix computeMatrix (const SpatialPosition& position, int numSourceChannels) noexcept;
+
+    template <typename Source, typename Output>
+    void processInSegments (const Source& source, int sourceStart,
+                            Output& output, int outputStart, int numSamples) noexcept;
+
+    void mixSegment (const QuadFrameBuffer& source, int sourceStart,
+                     juce::AudioSampleBuffer& output, int outputStart, int numSamples,
+                     const Matrix& from, const Matrix& to) const noexcept;
+
+    void mixSegment (const QuadFrameBuffer& source, int sourceStart,
+                     QuadFrameBuffer& output, int outputStart, int numSamples,
+                     const Matrix& from, const Matrix& to) const noexcept;
+
+    void mixSegment (const juce::AudioSampleBuffer& source, int sourceStart,
+                     juce::AudioSampleBuffer& output, int outputStart, int numSamples,
+                     const Matrix& from, const Matrix& to) const noexcept;
+
+    // The matrix columns as gains into L, R, Ls and Rs, ramping from `from` towards `to` one frame at a time
+    void getColumnGains (const Matrix& from, const Matrix& to, int numSamples,
+                         SimdFloat4 (&gains)[numOutputChannels], SimdFloat4 (&deltas)[numOutputChannels]) const noexcept;
+
+    Matrix current {};
+    SpatialPosition currentPosition, target;
+    int numSources = 0;
+};
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    WaveformView.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveformView.h"
+
+//==============================================================================
+WaveformView::WaveformView (ThumbnailCache& thumbnailsToShow)
+    : thumbnails (thumbnailsToShow)
+{
+    setOpaque (true);
+    thumbnails.addChangeListener (this);
+    refresh();
+}
+
+WaveformView::~WaveformView()
+{
+    thumbnails.removeChangeListener (this);
+}
+
+void WaveformView::setNote (int noteNumber, int layer)
+{
+    if (layer < 0)
+        layer = DynamicLayer::mezzoforte;
+
+    if (noteNumber == wantedNote && layer == wantedLayer)
+        return;
+
+    wantedNote = noteNumber;
+    wantedLayer = layer;
+    refresh();
+}
+
+void WaveformView::changeListenerCallback (juce::ChangeBroadcaster*)
+{
+    refresh();
+}
+
+void WaveformView::refresh()
+{
+    const auto notes = thumbnails.getNoteNumbers();
+
+    // Notes come back sorted; without a played note yet, show the lowest zone
+    int note = notes.isEmpty() ? -1 : notes.getFirst();
+
+    for (auto candidate : notes)
+        if (candidate <= wantedNote)
+            note = candidate;
+
+    auto thumbnail = thumbnails.getThumbnail (note, wantedLayer);
+
+    if (note == shownNote && thumbnail.summary == shown.summary)
+        return;
+
+    shownNote = note;
+    shown = std::move (thumbnail);
+    repaint();
+}
+
+//==============================================================================
+void WaveformView::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colours::black);
+
+    auto area = getLocalBounds().toFloat();
+    g.setFont (10.0f);
+
+    if (shown.summary == nullptr)
+    {
+        g.setColour (juce::Colours::grey);
+        g.drawText ("No samples loaded", area, juce::Justification::centred);
+        return;
+    }
+
+    const auto& summary = *shown.summary;
+
+    // Loop region across all lanes
+    if (summary.loop.isValid())
+    {
+        const auto xOf = [&] (int sample) { return area.getX() + area.getWidth() * (float) sample / (float) summary.numSamples; };
+
+        g.setColour (juce::Colours::orange.withAlpha (0.15f));
+        g.fillRect (juce::Rectangle<float>::leftTopRightBottom (xOf (summary.loop.start), area.getY(), xOf (summary.loop.end), area.getBottom()));
+        g.setColour (juce::Colours::orange);
+        g.drawVerticalLine (juce::roundToInt (xOf (summary.loop.start)), area.getY(), area.getBottom());
+        g.drawVerticalLine (juce::roundToInt (xOf (summary.loop.end)) - 1, area.getY(), area.getBottom());
+    }
+
+    const float laneHeight = area.getHeight() / (float) summary.numChannels;
+
+    for (int channel = 0; channel < summary.numChannels; ++channel)
+        paintLane (g, summary, channel, area.removeFromTop (laneHeight).reduced (0.0f, 1.0f));
+
+    g.setColour (juce::Colours::white);
+    g.drawText (shown.fileName + "  (note " + juce::String (shownNote) + ")", getLocalBounds().reduced (4, 2), juce::Justification::topLeft);
+}
+
+void WaveformView::paintLane (juce::Graphics& g, const WaveformSummary& summary, int channel, juce::Rectangle<float> area) const
+{
+    const int width = juce::roundToInt (area.getWidth());
+
+    if (width <= 0)
+        return;
+
+    const double samplesPerPixel = (double) summary.numSamples / width;
+    const auto& level = summary.getLevelFor (samplesPerPixel);
+    const float* mins = level.mins.data() + channel * level.numBins;
+    const float* maxs = level.maxs.data() + channel * level.numBins;
+
+    const float centre = area.getCentreY();
+    const float halfHeight = area.getHeight() * 0.5f;
+
+    g.setColour (juce::Colours::lightgreen);
+
+    for (int x = 0; x < width; ++x)
+    {
+        // All bins under this pixel column
+        const int firstBin = juce::jmin (level.numBins - 1, (int) (x * samplesPerPixel / level.samplesPerBin));
+        const int lastBin = juce::jlimit (firstBin + 1, level.numBins, (int) ((x + 1) * samplesPerPixel / level.samplesPerBin));
+
+        const float low = *std::min_element (mins + firstBin, mins + lastBin);
+        const float high = *std::max_element (maxs + firstBin, maxs + lastBin);
+
+        g.drawVerticalLine ((int) area.getX() + x,
+                            centre - juce::jlimit (-1.0f, 1.0f, high) * halfHeight,
+                            centre - juce::jlimit (-1.0f, 1.0f, low) * halfHeight + 1.0f);
+    }
+}
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    WaveformView.h
+    Draws the thumbnail of one zone: a lane per channel, with its sustain loop.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ThumbnailCache.h"
+
+//==============================================================================
+/**
+    Only ever reads the precomputed min/max summaries, never sample data, so
+    painting costs the same whatever the length of the sample.
+*/
+class WaveformView  : public juce::Component,
+                      private juce::ChangeListener
+{
+public:
+    explicit WaveformView (ThumbnailCache& thumbnailsToShow);
+    ~WaveformView() override;
+
+    // Shows the zone for this note, or the nearest one below it when there is none, in the
+    // given dynamic layer or the nearest one recorded. A negative layer means mezzoforte.
+    void setNote (int noteNumber, int layer);
+
+    void paint (juce::Graphics&) override;
+
+private:
+    void changeListenerCallback (juce::ChangeBroadcaster*) override;
+    void refresh();
+
+    void paintLane (juce::Graphics&, const WaveformSummary&, int channel, juce::Rectangle<float> area) const;
+
+    ThumbnailCache& thumbnails;
+    int wantedNote = -1, shownNote = -1;
+    int wantedLayer = DynamicLayer::mezzoforte;
+    ThumbnailCache::ZoneThumbnail shown;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformView)
+};
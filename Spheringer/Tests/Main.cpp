@@ -0,0 +1,29 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Runs the Spheringer unit tests. Returns 1 if any of them failed.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "RealtimeInterposer.h"
+
+//==============================================================================
+int main()
+{
+    const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    RealtimeInterposer::prepare();
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure (false);
+    runner.runTestsInCategory ("Spheringer");
+
+    int numFailures = 0;
+
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult (i)->failures;
+
+    return numFailures > 0 ? 1 : 0;
+}
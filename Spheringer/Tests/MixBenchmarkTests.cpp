@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    MixBenchmarkTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "MixBenchmark.h"
+
+//==============================================================================
+class MixBenchmarkTests  : public juce::UnitTest
+{
+public:
+    MixBenchmarkTests() : juce::UnitTest ("MixBenchmark", "Spheringer") {}
+
+    void runTest() override
+    {
+        // Blocks that end on a control interval and one that doesn't
+        for (const int blockSize : { 512, 100 })
+        {
+            beginTest ("Planar and interleaved zones mix to the same output, in blocks of " + juce::String (blockSize));
+
+            const auto result = MixBenchmark::run (16, blockSize, 2 * MixBenchmark::zoneLengthInBlocks + 3);
+            logMessage (result.toString());
+
+            // Sixteen voices of up to +-1 each: only the rounding differs
+            expectLessThan (result.maxDifference, 1.0e-4f);
+            expectGreaterThan (result.planarSecondsPerBlock, 0.0);
+            expectGreaterThan (result.interleavedSecondsPerBlock, 0.0);
+        }
+    }
+};
+
+static MixBenchmarkTests mixBenchmarkTests;
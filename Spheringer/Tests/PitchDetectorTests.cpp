@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    PitchDetectorTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PitchDetector.h"
+
+//==============================================================================
+class PitchDetectorTests  : public juce::UnitTest
+{
+public:
+    PitchDetectorTests() : juce::UnitTest ("PitchDetector", "Spheringer") {}
+
+    void runTest() override
+    {
+        beginTest ("Sine tones across the range land on their notes");
+
+        for (const int noteNumber : { 33, 45, 60, 69, 81, 96 })
+        {
+            const auto result = PitchDetector::detect (createTone (getFrequency (noteNumber), 1, 1), sampleRate, 0);
+            expect (result.isPitched, "note " + juce::String (noteNumber));
+            expectEquals (result.noteNumber, noteNumber);
+            expectWithinAbsoluteError (result.centsOffset, 0.0f, 2.0f);
+        }
+
+        beginTest ("A detuned note reports how far off it is");
+        {
+            const auto result = PitchDetector::detect (createTone (getFrequency (69) * std::pow (2.0, 30.0 / 1200.0), 1, 1), sampleRate, 0);
+            expectEquals (result.noteNumber, 69);
+            expectWithinAbsoluteError (result.centsOffset, 30.0f, 3.0f);
+        }
+
+        beginTest ("Strong harmonics don't pull it off the fundamental");
+        {
+            const auto result = PitchDetector::detect (createTone (getFrequency (45), 8, 1), sampleRate, 0);
+            expectEquals (result.noteNumber, 45);
+        }
+
+        beginTest ("All channels are looked at, not just the first");
+        {
+            const auto tone = createTone (getFrequency (72), 3, 1);
+            juce::AudioSampleBuffer quad (4, tone.getNumSamples());
+            quad.clear();
+            quad.copyFrom (3, 0, tone, 0, 0, tone.getNumSamples());
+
+            const auto result = PitchDetector::detect (quad, sampleRate, 0);
+            expectEquals (result.noteNumber, 72);
+        }
+
+        beginTest ("The attack before analysisStart is ignored");
+        {
+            auto buffer = createTone (getFrequency (64), 1, 1);
+            const int attackLength = (int) (0.2 * sampleRate);
+            auto random = getRandom();
+
+            for (int i = 0; i < attackLength; ++i)
+                buffer.setSample (0, i, random.nextFloat() * 2.0f - 1.0f);
+
+            const auto result = PitchDetector::detect (buffer, sampleRate, attackLength);
+            expectEquals (result.noteNumber, 64);
+        }
+
+        beginTest ("Noise, silence and very short samples aren't pitched");
+        {
+            juce::AudioSampleBuffer noise (1, (int) sampleRate);
+            auto random = getRandom();
+
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample (0, i, random.nextFloat() * 2.0f - 1.0f);
+
+            expect (! PitchDetector::detect (noise, sampleRate, 0).isPitched);
+
+            juce::AudioSampleBuffer silence (1, (int) sampleRate);
+            silence.clear();
+            expect (! PitchDetector::detect (silence, sampleRate, 0).isPitched);
+
+            juce::AudioSampleBuffer tooShort (1, 256);
+            tooShort.copyFrom (0, 0, createTone (getFrequency (69), 1, 1), 0, 0, 256);
+            expect (! PitchDetector::detect (tooShort, sampleRate, 0).isPitched);
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+
+    static double getFrequency (int noteNumber)
+    {
+        return 440.0 * std::pow (2.0, (noteNumber - 69) / 12.0);
+    }
+
+    // One second of the first numHarmonics harmonics at 1 / k, on every channel
+    static juce::AudioSampleBuffer createTone (double frequency, int numHarmonics, int numChannels)
+    {
+        juce::AudioSampleBuffer buffer (numChannels, (int) sampleRate);
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            double value = 0.0;
+
+            for (int k = 1; k <= numHarmonics && k * frequency < 0.5 * sampleRate; ++k)
+                value += std::sin (juce::MathConstants<double>::twoPi * k * frequency * i / sampleRate) / k;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                buffer.setSample (channel, i, 0.5f * (float) value);
+        }
+
+        return buffer;
+    }
+};
+
+static PitchDetectorTests pitchDetectorTests;
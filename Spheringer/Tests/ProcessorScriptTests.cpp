@@ -0,0 +1,290 @@
+/*
+  ==============================================================================
+
+    ProcessorScriptTests.cpp
+    Plays a script of loads, MIDI and parameter changes through the processor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    One command per line, # starts a comment. Blocks are 512 samples at 48 kHz.
+
+        load <folder> <wildcard>         copy the example WAVs whose names match into a folder and add it as a program
+        waitFor <note>                   play the note until a voice sounds, i.e. its library has been loaded
+        wait <ms>                        keep rendering blocks for that long, so the loader can catch up
+        render <blocks>
+        noteOn <note> <velocity>
+        noteOff <note>
+        cc <controller> <value>
+        program <number>
+        volume <dB>
+        adsr <attack> <decay> <sustain> <release>
+        cpuBudget <fraction of the buffer period>
+        spread <keyboard degrees> <random degrees>
+        dynamics on|off                  layers from the mod wheel or expression instead of velocity
+        memoryBudget <bytes>
+        offline on|off
+        replace <folder> <wildcard> <wildcard>   overwrite a loaded file with another example WAV
+
+    Wildcards match file names without the .wav, e.g. *_forte_*.
+    MIDI goes into the next rendered block. With SPHERINGER_REALTIME_GUARD on, and
+    the interposer on Linux, anything processBlock must not do fails the run.
+*/
+class ProcessorScriptTests  : public juce::UnitTest
+{
+public:
+    ProcessorScriptTests() : juce::UnitTest ("Processor script", "Spheringer") {}
+
+    void runTest() override
+    {
+        beginTest ("Loads, notes, controllers and parameter changes");
+        run (R"(
+            load Voices *
+            load Forte *_forte_*
+            program 0
+            waitFor 69
+            noteOn 72 100
+            render 20
+
+            cc 10 64
+            cc 16 30
+            cc 17 127
+            volume -6
+            render 20
+            adsr 0.01 0.2 0.7 0.3
+            render 10
+            noteOff 69
+            noteOff 72
+            render 40
+
+            dynamics on
+            cc 1 90
+            noteOn 74 80
+            render 20
+            cc 11 20
+            render 20
+            noteOff 74
+            dynamics off
+
+            spread 90 30
+            program 1
+            waitFor 74
+            noteOn 72 127
+            render 40
+            cpuBudget 0.05
+            noteOn 69 127
+            noteOn 74 110
+            render 40
+            cpuBudget 0.7
+            noteOff 69
+            noteOff 72
+            noteOff 74
+            render 100
+        )");
+
+        beginTest ("Eviction, a changed file and an offline bounce");
+        run (R"(
+            load Voices *
+            waitFor 72
+            noteOff 72
+            memoryBudget 4000000
+            wait 1500
+            noteOn 69 100
+            noteOn 74 100
+            render 40
+            noteOff 69
+            noteOff 74
+
+            replace Voices *_forte_C5_72 *_piano_C5_72
+            wait 3000
+            noteOn 72 100
+            render 40
+            noteOff 72
+            render 100
+
+            offline on
+            noteOn 69 100
+            noteOn 72 100
+            noteOn 74 100
+            render 100
+            noteOff 69
+            noteOff 72
+            noteOff 74
+            render 100
+            offline off
+            render 20
+        )");
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 512;
+    static constexpr int waitTimeoutMs = 20000;
+
+    std::unique_ptr<SpheringerAudioProcessor> processor;
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+    juce::File folders;
+
+    static juce::File getExampleSamples()
+    {
+        return juce::File (SPHERINGER_TEST_SAMPLES);
+    }
+
+    void run (const juce::String& script)
+    {
+        folders = juce::File::getSpecialLocation (juce::File::tempDirectory).getNonexistentChildFile ("SpheringerTests", {}, false);
+        expect (folders.createDirectory().wasOk());
+
+        processor = std::make_unique<SpheringerAudioProcessor>();
+        processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor->prepareToPlay (sampleRate, blockSize);
+        buffer.setSize (processor->getTotalNumOutputChannels(), blockSize);
+
+        const auto violationsBefore = RealtimeGuard::getNumViolations();
+
+        for (auto line : juce::StringArray::fromLines (script))
+        {
+            line = line.upToFirstOccurrenceOf ("#", false, false).trim();
+
+            if (line.isNotEmpty())
+                runCommand (line);
+        }
+
+        expectEquals (RealtimeGuard::getNumViolations(), violationsBefore, "processBlock did something it must not do");
+
+        processor->releaseResources();
+        processor.reset();
+        folders.deleteRecursively();
+    }
+
+    void runCommand (const juce::String& line)
+    {
+        auto words = juce::StringArray::fromTokens (line, false);
+        words.removeEmptyStrings();
+
+        const auto command = words[0];
+        const auto number = [&words] (int i) { return words[i].getFloatValue(); };
+        const auto integer = [&words] (int i) { return words[i].getIntValue(); };
+
+        logMessage (line);
+
+        if (command == "load")                 load (words[1], words[2]);
+        else if (command == "waitFor")         waitFor (integer (1));
+        else if (command == "wait")            wait (integer (1));
+        else if (command == "render")          render (integer (1));
+        else if (command == "noteOn")          midi.addEvent (juce::MidiMessage::noteOn (1, integer (1), (juce::uint8) integer (2)), 0);
+        else if (command == "noteOff")         midi.addEvent (juce::MidiMessage::noteOff (1, integer (1)), 0);
+        else if (command == "cc")              midi.addEvent (juce::MidiMessage::controllerEvent (1, integer (1), integer (2)), 0);
+        else if (command == "program")         midi.addEvent (juce::MidiMessage::programChange (1, integer (1)), 0);
+        else if (command == "volume")          processor->volume.setTargetValue (number (1));
+        else if (command == "adsr")            setADSR ({ number (1), number (2), number (3), number (4) });
+        else if (command == "cpuBudget")       processor->setCpuBudget (number (1));
+        else if (command == "spread")          processor->setVoiceSpread (number (1), number (2));
+        else if (command == "dynamics")        processor->setDynamicsFromController (words[1] == "on");
+        else if (command == "memoryBudget")    processor->setSampleMemoryBudget (words[1].getLargeIntValue());
+        else if (command == "offline")         processor->setNonRealtime (words[1] == "on");
+        else if (command == "replace")         replace (words[1], words[2], words[3]);
+        else                                   expect (false, "Unknown command: " + line);
+    }
+
+    void render (int numBlocks)
+    {
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            processor->processBlock (buffer, midi);
+            midi.clear();
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            {
+                const auto range = buffer.findMinMax (channel, 0, buffer.getNumSamples());
+
+                if (! (std::isfinite (range.getStart()) && std::isfinite (range.getEnd())))
+                {
+                    expect (false, "Output isn't finite");
+                    return;
+                }
+            }
+        }
+    }
+
+    // The loader works in the background: render while waiting, like a host would
+    void wait (int milliseconds)
+    {
+        const auto until = juce::Time::getMillisecondCounter() + (juce::uint32) milliseconds;
+
+        while (juce::Time::getMillisecondCounter() < until)
+        {
+            render (1);
+            juce::Thread::sleep (5);
+        }
+    }
+
+    void waitFor (int noteNumber)
+    {
+        const auto giveUpAt = juce::Time::getMillisecondCounter() + (juce::uint32) waitTimeoutMs;
+
+        while (processor->getDiagnostics().activeVoices.load() == 0)
+        {
+            if (juce::Time::getMillisecondCounter() > giveUpAt)
+            {
+                expect (false, "Note " + juce::String (noteNumber) + " never started");
+                return;
+            }
+
+            midi.addEvent (juce::MidiMessage::noteOn (1, noteNumber, (juce::uint8) 100), 0);
+            render (1);
+            juce::Thread::sleep (5);
+        }
+    }
+
+    void setADSR (const juce::ADSR::Parameters& parameters)
+    {
+        processor->getADSRParams() = parameters;
+        processor->updateADSR();
+    }
+
+    void load (const juce::String& folderName, const juce::String& wildcard)
+    {
+        const auto folder = folders.getChildFile (folderName);
+        folder.createDirectory();
+
+        const auto examples = getExampleSamples().findChildFiles (juce::File::findFiles, false, wildcard + ".wav");
+        expect (! examples.isEmpty(), "No example WAVs match " + wildcard);
+
+        for (const auto& example : examples)
+            copySettled (example, folder.getChildFile (example.getFileName()));
+
+        processor->addProgram (folder);
+    }
+
+    void replace (const juce::String& folderName, const juce::String& wildcard, const juce::String& withWildcard)
+    {
+        const auto folder = folders.getChildFile (folderName);
+        const auto targets = folder.findChildFiles (juce::File::findFiles, false, wildcard + ".wav");
+        const auto sources = getExampleSamples().findChildFiles (juce::File::findFiles, false, withWildcard + ".wav");
+
+        if (targets.size() != 1 || sources.size() != 1)
+        {
+            expect (false, "replace needs exactly one file on each side: " + wildcard + ", " + withWildcard);
+            return;
+        }
+
+        copySettled (sources.getFirst(), targets.getFirst());
+    }
+
+    // The loader leaves files alone until they've stopped changing, so date the copy back past that
+    static void copySettled (const juce::File& source, const juce::File& destination)
+    {
+        source.copyFileTo (destination);
+        destination.setLastModificationTime (juce::Time::getCurrentTime()
+                                               - juce::RelativeTime::milliseconds (2 * LibraryLoader::settleTimeMs));
+    }
+};
+
+static ProcessorScriptTests processorScriptTests;
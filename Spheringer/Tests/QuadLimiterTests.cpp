@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    QuadLimiterTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "QuadLimiter.h"
+
+//==============================================================================
+class QuadLimiterTests  : public juce::UnitTest
+{
+public:
+    QuadLimiterTests() : juce::UnitTest ("QuadLimiter", "Spheringer") {}
+
+    void runTest() override
+    {
+        testSlidingMax();
+        testBoxcar();
+        testLatency();
+        testCeiling();
+        testInterSamplePeaks();
+        testLinkedGain();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 512;
+
+    void testSlidingMax()
+    {
+        beginTest ("SlidingMax returns the maximum of the last windowLength values");
+
+        for (const int windowLength : { 1, 2, 7, 64 })
+        {
+            QuadLimiter::SlidingMax slidingMax;
+            slidingMax.prepare (windowLength);
+
+            auto random = getRandom();
+            std::vector<float> pushed;
+            int numWrong = 0;
+
+            for (int i = 0; i < 1000; ++i)
+            {
+                pushed.push_back (random.nextFloat());
+
+                // Before the window has filled up, the values it hasn't seen yet count as 0
+                const auto first = pushed.end() - juce::jmin ((int) pushed.size(), windowLength);
+                numWrong += slidingMax.push (pushed.back()) != *std::max_element (first, pushed.end()) ? 1 : 0;
+            }
+
+            expectEquals (numWrong, 0, "window of " + juce::String (windowLength));
+        }
+    }
+
+    void testBoxcar()
+    {
+        beginTest ("Boxcar returns the mean of the last length values, starting from the initial value");
+
+        constexpr int length = 16;
+        QuadLimiter::Boxcar boxcar;
+        boxcar.prepare (length, 1.0f);
+
+        auto random = getRandom();
+        std::vector<float> pushed ((size_t) length, 1.0f);
+        float maxError = 0.0f;
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            pushed.push_back (random.nextFloat());
+
+            const auto mean = std::accumulate (pushed.end() - length, pushed.end(), 0.0) / length;
+            maxError = juce::jmax (maxError, std::abs (boxcar.push (pushed.back()) - (float) mean));
+        }
+
+        expectWithinAbsoluteError (maxError, 0.0f, 1.0e-6f);
+    }
+
+    void testLatency()
+    {
+        beginTest ("Audio under the ceiling only comes out later, by the reported latency");
+
+        QuadLimiter limiter;
+        limiter.prepare (sampleRate, blockSize);
+
+        const int latency = limiter.getLatencySamples();
+        expectEquals (latency, juce::roundToInt (QuadLimiter::lookaheadSeconds * sampleRate) + QuadLimiter::TruePeakDetector::delay);
+
+        juce::AudioSampleBuffer buffer (4, blockSize);
+        buffer.clear();
+
+        for (int channel = 0; channel < 4; ++channel)
+            buffer.setSample (channel, 0, 0.25f * (float) (channel + 1) / 4.0f);
+
+        limiter.process (buffer);
+
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            expectEquals (buffer.getSample (channel, latency), 0.25f * (float) (channel + 1) / 4.0f);
+            expectEquals (buffer.getMagnitude (channel, 0, latency), 0.0f);
+        }
+
+        expectEquals (limiter.getMinimumGain(), 1.0f);
+    }
+
+    void testCeiling()
+    {
+        const float ceiling = juce::Decibels::decibelsToGain (QuadLimiter::ceilingDb);
+
+        // Blocks bigger than announced are split up inside
+        for (const int hostBlockSize : { blockSize, 3 * blockSize + 17 })
+        {
+            beginTest ("Loud tones stay under the ceiling, in blocks of " + juce::String (hostBlockSize));
+
+            QuadLimiter limiter;
+            limiter.prepare (sampleRate, blockSize);
+
+            juce::AudioSampleBuffer buffer (4, hostBlockSize);
+            float peak = 0.0f, minimumGain = 1.0f;
+            int sample = 0;
+
+            for (int block = 0; block < 40; ++block)
+            {
+                // +12 dB, a different frequency on every channel, up to close to Nyquist
+                for (int channel = 0; channel < 4; ++channel)
+                    for (int i = 0; i < hostBlockSize; ++i)
+                        buffer.setSample (channel, i, 4.0f * (float) std::sin (juce::MathConstants<double>::twoPi
+                                                                                  * (1000.0 + 6000.0 * channel) * (sample + i) / sampleRate));
+
+                sample += hostBlockSize;
+                limiter.process (buffer);
+
+                peak = juce::jmax (peak, buffer.getMagnitude (0, hostBlockSize));
+                minimumGain = juce::jmin (minimumGain, limiter.getMinimumGain());
+            }
+
+            expectLessOrEqual (peak, ceiling);
+            expectLessThan (minimumGain, 0.3f);
+        }
+    }
+
+    void testInterSamplePeaks()
+    {
+        beginTest ("Peaks between the samples are brought under the ceiling too");
+
+        QuadLimiter limiter;
+        limiter.prepare (sampleRate, blockSize);
+
+        // A sine at a quarter of the sample rate, sampled 22.5 degrees either side of its crests:
+        // its samples stay under the ceiling, but the waveform between them goes over it
+        const float ceiling = juce::Decibels::decibelsToGain (QuadLimiter::ceilingDb);
+        const float amplitude = 0.95f;
+        const double phase = juce::MathConstants<double>::pi / 8.0;
+
+        juce::AudioSampleBuffer buffer (4, blockSize);
+        float samplePeak = 0.0f, truePeak = 0.0f, previous = 0.0f;
+        int sample = 0;
+
+        for (int block = 0; block < 40; ++block)
+        {
+            for (int i = 0; i < blockSize; ++i, ++sample)
+                for (int channel = 0; channel < 4; ++channel)
+                    buffer.setSample (channel, i, amplitude * (float) std::sin (juce::MathConstants<double>::halfPi * sample + phase));
+
+            samplePeak = juce::jmax (samplePeak, buffer.getMagnitude (0, blockSize));
+            limiter.process (buffer);
+
+            // At fs / 4 two samples in a row are a quarter cycle apart, so together they give the amplitude
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const float current = buffer.getSample (0, i);
+
+                if (block >= 4)
+                    truePeak = juce::jmax (truePeak, std::hypot (previous, current));
+
+                previous = current;
+            }
+        }
+
+        expectLessThan (samplePeak, ceiling);
+        expectLessOrEqual (truePeak, ceiling * 1.005f);
+    }
+
+    void testLinkedGain()
+    {
+        beginTest ("All four channels get the same gain, so the image doesn't move");
+
+        QuadLimiter limiter;
+        limiter.prepare (sampleRate, blockSize);
+
+        // Loud on L only, the others are quieter copies of it
+        const float levels[] { 1.0f, 0.5f, 0.25f, 0.0f };
+        juce::AudioSampleBuffer buffer (4, blockSize);
+        float maxError = 0.0f;
+        int sample = 0;
+
+        for (int block = 0; block < 20; ++block)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const auto value = 3.0f * (float) std::sin (juce::MathConstants<double>::twoPi * 440.0 * sample++ / sampleRate);
+
+                for (int channel = 0; channel < 4; ++channel)
+                    buffer.setSample (channel, i, levels[channel] * value);
+            }
+
+            limiter.process (buffer);
+
+            for (int channel = 1; channel < 4; ++channel)
+                for (int i = 0; i < blockSize; ++i)
+                    maxError = juce::jmax (maxError, std::abs (buffer.getSample (channel, i) - levels[channel] * buffer.getSample (0, i)));
+        }
+
+        expectLessThan (limiter.getMinimumGain(), 0.5f);
+        expectWithinAbsoluteError (maxError, 0.0f, 1.0e-6f);
+    }
+};
+
+static QuadLimiterTests quadLimiterTests;
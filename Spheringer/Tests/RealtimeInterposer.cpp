@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    RealtimeInterposer.cpp
+
+  ==============================================================================
+*/
+
+// The fortified open() is an inline wrapper that can't be redefined
+#undef _FORTIFY_SOURCE
+
+#include "RealtimeInterposer.h"
+#include "RealtimeGuard.h"
+
+#if JUCE_LINUX && SPHERINGER_REALTIME_GUARD
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+extern "C"
+{
+    // glibc's own allocator, behind the public names
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void  __libc_free (void*);
+}
+
+namespace
+{
+    using MutexLockFunction = int (*) (pthread_mutex_t*);
+    using OpenFunction      = int (*) (const char*, int, ...);
+    using WriteFunction     = ssize_t (*) (int, const void*, size_t);
+    using FwriteFunction    = size_t (*) (const void*, size_t, size_t, FILE*);
+
+    std::atomic<MutexLockFunction> realMutexLock {nullptr};
+    std::atomic<OpenFunction> realOpen {nullptr}, realOpen64 {nullptr};
+    std::atomic<WriteFunction> realWrite {nullptr};
+    std::atomic<FwriteFunction> realFwrite {nullptr};
+
+    // Set while a report is being written, so the report itself isn't reported
+    thread_local bool reporting = false;
+
+    template <typename Function>
+    Function getReal (std::atomic<Function>& function, const char* name) noexcept
+    {
+        auto* resolved = function.load (std::memory_order_relaxed);
+
+        if (resolved == nullptr)
+        {
+            resolved = reinterpret_cast<Function> (dlsym (RTLD_NEXT, name));
+            function.store (resolved, std::memory_order_relaxed);
+        }
+
+        return resolved;
+    }
+
+    void writeToStderr (const char* text) noexcept
+    {
+        if (auto* write = getReal (realWrite, "write"))
+            (void) write (STDERR_FILENO, text, std::strlen (text));
+    }
+
+    [[noreturn]] void fail (const char* what) noexcept
+    {
+        reporting = true;
+
+        writeToStderr ("Real-time violation in the audio callback: ");
+        writeToStderr (what);
+        writeToStderr ("\n");
+
+        void* frames[64];
+        backtrace_symbols_fd (frames, backtrace (frames, 64), STDERR_FILENO);
+
+        std::abort();
+    }
+
+    inline void check (const char* what) noexcept
+    {
+        if (RealtimeGuard::isAudioCallbackActive() && ! reporting)
+            fail (what);
+    }
+
+    mode_t getMode (int flags, va_list args) noexcept
+    {
+        return (flags & (O_CREAT | O_TMPFILE)) != 0 ? (mode_t) va_arg (args, unsigned int) : 0;
+    }
+}
+
+//==============================================================================
+void RealtimeInterposer::prepare()
+{
+    void* frames[1];
+    (void) backtrace (frames, 1);
+
+    getReal (realMutexLock, "pthread_mutex_lock");
+    getReal (realOpen, "open");
+    getReal (realOpen64, "open64");
+    getReal (realWrite, "write");
+    getReal (realFwrite, "fwrite");
+}
+
+//==============================================================================
+extern "C"
+{
+    void* malloc (size_t size) noexcept
+    {
+        check ("malloc");
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size) noexcept
+    {
+        check ("calloc");
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* memory, size_t size) noexcept
+    {
+        check ("realloc");
+        return __libc_realloc (memory, size);
+    }
+
+    void free (void* memory) noexcept
+    {
+        if (memory != nullptr)
+            check ("free");
+
+        __libc_free (memory);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+    {
+        check ("pthread_mutex_lock");
+        return getReal (realMutexLock, "pthread_mutex_lock") (mutex);
+    }
+
+    int open (const char* path, int flags, ...)
+    {
+        check ("open");
+
+        va_list args;
+        va_start (args, flags);
+        const auto mode = getMode (flags, args);
+        va_end (args);
+
+        return getReal (realOpen, "open") (path, flags, mode);
+    }
+
+    int open64 (const char* path, int flags, ...)
+    {
+        check ("open");
+
+        va_list args;
+        va_start (args, flags);
+        const auto mode = getMode (flags, args);
+        va_end (args);
+
+        return getReal (realOpen64, "open64") (path, flags, mode);
+    }
+
+    ssize_t write (int fd, const void* data, size_t size)
+    {
+        check ("write");
+        return getReal (realWrite, "write") (fd, data, size);
+    }
+
+    // std::cout and printf reach write() inside libc, where it can't be interposed
+    size_t fwrite (const void* data, size_t size, size_t count, FILE* stream)
+    {
+        check ("fwrite");
+        return getReal (realFwrite, "fwrite") (data, size, count, stream);
+    }
+}
+
+#else
+
+void RealtimeInterposer::prepare() {}
+
+#endif
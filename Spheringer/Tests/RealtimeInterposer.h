@@ -0,0 +1,27 @@
+/*
+  ==============================================================================
+
+    RealtimeInterposer.h
+    Test builds on Linux: catches what RealtimeGuard can't see from inside the plugin.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+/**
+    The test executable defines its own malloc, calloc, realloc, free,
+    pthread_mutex_lock, open and write. It is linked with -rdynamic, so calls
+    from JUCE and the system libraries end up there too. Each one hands over to
+    libc, unless a RealtimeGuard::ScopedAudioCallback is alive on the calling
+    thread: then it prints the call and a stack trace, and aborts the run.
+
+    Everywhere else this compiles to nothing.
+*/
+namespace RealtimeInterposer
+{
+    // Call once at startup, before the first audio callback: the first stack trace
+    // loads the unwinder, which allocates
+    void prepare();
+}
@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    SamplePreprocessorTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "SamplePreprocessor.h"
+
+//==============================================================================
+class SamplePreprocessorTests  : public juce::UnitTest
+{
+public:
+    SamplePreprocessorTests() : juce::UnitTest ("SamplePreprocessor", "Spheringer") {}
+
+    void runTest() override
+    {
+        // A tone from onsetAt to decayEnd on a DC offset, silence around it. The second channel is only offset.
+        const auto source = createRecording();
+        const auto trim = SamplePreprocessor::analyse (source, sampleRate);
+
+        const int preRoll = juce::roundToInt (SamplePreprocessor::preRollSeconds * sampleRate);
+        const int tail = juce::roundToInt (SamplePreprocessor::tailSeconds * sampleRate);
+
+        beginTest ("DC offset is measured per channel");
+        expectEquals ((int) trim.dcOffsets.size(), 2);
+        expectWithinAbsoluteError (trim.dcOffsets[0], dcOffset, 1.0e-4f);
+        expectWithinAbsoluteError (trim.dcOffsets[1], -dcOffset, 1.0e-6f);
+
+        beginTest ("Silence before the onset is trimmed down to the pre-roll");
+        expect (trim.isTrimmed());
+        expectEquals (trim.sourceLength, length);
+        expectEquals (trim.start, onsetAt - preRoll);
+        expectEquals (trim.fadeInLength, preRoll);
+
+        beginTest ("Silence after the decay is trimmed down to the tail");
+        expectEquals (trim.start + trim.length, decayEnd + tail);
+        expectEquals (trim.fadeOutLength, tail);
+
+        beginTest ("apply() removes the offset and fades the ends");
+        const auto trimmed = SamplePreprocessor::apply (source, trim);
+        expectEquals (trimmed.getNumSamples(), trim.length);
+        expectWithinAbsoluteError (trimmed.getSample (0, 0), 0.0f, 1.0e-4f);
+        expectWithinAbsoluteError (trimmed.getSample (0, preRoll), amplitude, 1.0e-4f);
+        expectWithinAbsoluteError (trimmed.getSample (0, trim.length - 1), 0.0f, 1.0e-3f);
+        expectWithinAbsoluteError (trimmed.getMagnitude (1, 0, trim.length), 0.0f, 1.0e-6f);
+
+        beginTest ("applyInPlace() on the trimmed region matches apply()");
+        juce::AudioSampleBuffer region (2, trim.length);
+
+        for (int channel = 0; channel < 2; ++channel)
+            region.copyFrom (channel, 0, source, channel, trim.start, trim.length);
+
+        SamplePreprocessor::applyInPlace (region, trim);
+        int numDifferent = 0;
+
+        for (int channel = 0; channel < 2; ++channel)
+            for (int i = 0; i < trim.length; ++i)
+                numDifferent += region.getSample (channel, i) != trimmed.getSample (channel, i) ? 1 : 0;
+
+        expectEquals (numDifferent, 0);
+
+        beginTest ("A protected loop survives the trim and isn't faded");
+        const auto looped = SamplePreprocessor::analyse (source, sampleRate, length);
+        expectEquals (looped.start + looped.length, length);
+        expectEquals (looped.fadeOutLength, 0);
+
+        beginTest ("A silent file is left whole");
+        juce::AudioSampleBuffer silence (1, length);
+
+        for (int i = 0; i < length; ++i)
+            silence.setSample (0, i, dcOffset);
+
+        const auto silent = SamplePreprocessor::analyse (silence, sampleRate);
+        expect (! silent.isTrimmed());
+        expectEquals (silent.fadeInLength, 0);
+        expectEquals (silent.fadeOutLength, 0);
+        expectWithinAbsoluteError (silent.dcOffsets[0], dcOffset, 1.0e-6f);
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int length = 48000, onsetAt = 4800, decayEnd = 24000;
+    static constexpr float amplitude = 0.5f, dcOffset = 0.1f;
+
+    // 480 Hz: a whole number of cycles, so the tone adds nothing to the mean
+    static juce::AudioSampleBuffer createRecording()
+    {
+        juce::AudioSampleBuffer buffer (2, length);
+
+        for (int i = 0; i < length; ++i)
+        {
+            const bool isSounding = i >= onsetAt && i < decayEnd;
+            const auto tone = amplitude * std::cos (juce::MathConstants<double>::twoPi * 480.0 * (i - onsetAt) / sampleRate);
+
+            buffer.setSample (0, i, dcOffset + (isSounding ? (float) tone : 0.0f));
+            buffer.setSample (1, i, -dcOffset);
+        }
+
+        return buffer;
+    }
+};
+
+static SamplePreprocessorTests samplePreprocessorTests;
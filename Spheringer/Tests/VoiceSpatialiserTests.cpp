@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    VoiceSpatialiserTests.cpp
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "VoiceSpatialiser.h"
+
+//==============================================================================
+class VoiceSpatialiserTests  : public juce::UnitTest
+{
+public:
+    VoiceSpatialiserTests() : juce::UnitTest ("VoiceSpatialiser", "Spheringer") {}
+
+    void runTest() override
+    {
+        auto random = getRandom();
+        juce::AudioSampleBuffer planar (4, numFrames);
+
+        for (int channel = 0; channel < 4; ++channel)
+            for (int i = 0; i < numFrames; ++i)
+                planar.setSample (channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+        QuadFrameBuffer frames;
+        frames.setSize (numFrames);
+        frames.copyFrom (planar, 0, 0, numFrames);
+
+        beginTest ("At the front with full width, quad samples come out untouched");
+        {
+            VoiceSpatialiser spatialiser;
+            spatialiser.reset ({}, 4);
+
+            juce::AudioSampleBuffer output (4, numFrames);
+            output.clear();
+            spatialiser.process (frames, 0, output, 0, numFrames);
+
+            for (int channel = 0; channel < 4; ++channel)
+                expectWithinAbsoluteError (getMaxDifference (output, channel, planar, channel), 0.0f, tolerance);
+        }
+
+        beginTest ("The interleaved and planar outputs are the same");
+        {
+            const SpatialPosition position { 0.7f, 0.3f, 0.5f };
+            VoiceSpatialiser toPlanar, toFrames;
+            toPlanar.reset (position, 4);
+            toFrames.reset (position, 4);
+
+            juce::AudioSampleBuffer planarOutput (4, numFrames), interleavedOutput (4, numFrames);
+            planarOutput.clear();
+
+            QuadFrameBuffer frameOutput;
+            frameOutput.setSize (numFrames);
+
+            toPlanar.process (frames, 0, planarOutput, 0, numFrames);
+            toFrames.process (frames, 0, frameOutput, 0, numFrames);
+            frameOutput.copyTo (interleavedOutput, 0, 0, numFrames);
+
+            for (int channel = 0; channel < 4; ++channel)
+                expectWithinAbsoluteError (getMaxDifference (interleavedOutput, channel, planarOutput, channel), 0.0f, tolerance);
+        }
+
+        beginTest ("Turned all the way round, front and back swap sides");
+        {
+            VoiceSpatialiser spatialiser;
+            spatialiser.reset ({ juce::MathConstants<float>::pi, 0.0f, 1.0f }, 4);
+
+            juce::AudioSampleBuffer output (4, numFrames);
+            output.clear();
+            spatialiser.process (frames, 0, output, 0, numFrames);
+
+            // L <-> Rs, R <-> Ls
+            expectWithinAbsoluteError (getMaxDifference (output, 3, planar, 0), 0.0f, tolerance);
+            expectWithinAbsoluteError (getMaxDifference (output, 2, planar, 1), 0.0f, tolerance);
+            expectWithinAbsoluteError (getMaxDifference (output, 1, planar, 2), 0.0f, tolerance);
+            expectWithinAbsoluteError (getMaxDifference (output, 0, planar, 3), 0.0f, tolerance);
+        }
+
+        beginTest ("A mono source is spread evenly over the quad");
+        {
+            VoiceSpatialiser spatialiser;
+            spatialiser.reset ({}, 1);
+
+            juce::AudioSampleBuffer mono (1, numFrames);
+            mono.copyFrom (0, 0, planar, 0, 0, numFrames);
+
+            QuadFrameBuffer monoFrames;
+            monoFrames.setSize (numFrames);
+            monoFrames.copyFrom (mono, 0, 0, numFrames);
+
+            juce::AudioSampleBuffer output (4, numFrames);
+            output.clear();
+            spatialiser.process (monoFrames, 0, output, 0, numFrames);
+
+            juce::AudioSampleBuffer expected (1, numFrames);
+            expected.copyFrom (0, 0, mono, 0, 0, numFrames);
+            expected.applyGain (0.5f);
+
+            for (int channel = 0; channel < 4; ++channel)
+                expectWithinAbsoluteError (getMaxDifference (output, channel, expected, 0), 0.0f, tolerance);
+        }
+
+        beginTest ("A move glides over one control interval, then holds");
+        {
+            VoiceSpatialiser spatialiser;
+            spatialiser.reset ({}, 4);
+            spatialiser.setTarget ({ juce::MathConstants<float>::pi, 0.0f, 1.0f });
+
+            juce::AudioSampleBuffer output (4, numFrames);
+            output.clear();
+            spatialiser.process (frames, 0, output, 0, numFrames);
+
+            // Frame i of the glide is (i + 1) / controlInterval of the way there, so the last one has arrived
+            const int interval = VoiceSpatialiser::controlInterval;
+            const float halfWay = 0.5f * (planar.getSample (0, interval / 2 - 1) + planar.getSample (3, interval / 2 - 1));
+            expectWithinAbsoluteError (output.getSample (0, interval / 2 - 1), halfWay, tolerance);
+
+            float difference = 0.0f;
+
+            for (int i = interval - 1; i < numFrames; ++i)
+                difference = juce::jmax (difference, std::abs (output.getSample (3, i) - planar.getSample (0, i)));
+
+            expectWithinAbsoluteError (difference, 0.0f, tolerance);
+        }
+    }
+
+private:
+    static constexpr int numFrames = 256;
+    static constexpr float tolerance = 1.0e-5f;
+
+    static float getMaxDifference (const juce::AudioSampleBuffer& a, int channelA, const juce::AudioSampleBuffer& b, int channelB)
+    {
+        float difference = 0.0f;
+
+        for (int i = 0; i < a.getNumSamples(); ++i)
+            difference = juce::jmax (difference, std::abs (a.getSample (channelA, i) - b.getSample (channelB, i)));
+
+        return difference;
+    }
+};
+
+static VoiceSpatialiserTests voiceSpatialiserTests;